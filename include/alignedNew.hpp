@@ -0,0 +1,40 @@
+#pragma once
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+/*
+ * Cache line aligned heap objects
+ *
+ * C++11 new ignores alignas above the default, hosts create plugins with
+ * new so a class with a 64 byte aligned member declares this to get its
+ * alignment back.
+ */
+inline void* robotAlignedAlloc(std::size_t size, std::size_t align)
+{
+#ifdef _WIN32
+    void* ptr = _aligned_malloc(size, align);
+#else
+    void* ptr = nullptr;
+    if (posix_memalign(&ptr, align < sizeof(void*) ? sizeof(void*) : align, size) != 0)
+        ptr = nullptr;
+#endif
+    if (ptr == nullptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+inline void robotAlignedFree(void* ptr)
+{
+#ifdef _WIN32
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+}
+
+#define ROBOT_DECLARE_ALIGNED_NEW(ClassName) \
+    static void* operator new(std::size_t size) { return robotAlignedAlloc(size, alignof(ClassName)); } \
+    static void  operator delete(void* ptr) { robotAlignedFree(ptr); }
@@ -0,0 +1,103 @@
+#pragma once
+#include <cstdint>
+/*
+ * Parameter curves as tables built by the compiler
+ *
+ * The logsc() mapping and the wet curve only depend on a 0-1 parameter,
+ * so they are evaluated in constexpr at compile time and read back with
+ * linear interpolation. No exp() at runtime and nothing to build at
+ * startup. 1024 steps keep both within about 1e-6 of the exact curve.
+ */
+
+struct RobotCurveTable
+{
+    static const uint32_t kSize = 1024;
+
+    // x in 0-1, clamped
+    inline float lookup(float x) const
+    {
+        if (x < 0.0f) x = 0.0f;
+        if (x > 1.0f) x = 1.0f;
+        const float pos  = x * kSize;
+        uint32_t    i    = (uint32_t)pos;
+        if (i >= kSize) i = kSize - 1;
+        const float frac = pos - i;
+        return value[i] + frac * (value[i+1] - value[i]);
+    }
+
+    float value[kSize+1];
+};
+
+// -----------------------------------------------------------------------
+// Compile time helpers, C++11 constexpr is one return statement
+
+template<uint32_t... I> struct RobotIndices {};
+
+template<class A, class B> struct RobotConcatIndices;
+template<uint32_t... I, uint32_t... J>
+struct RobotConcatIndices<RobotIndices<I...>, RobotIndices<J...>>
+{
+    typedef RobotIndices<I..., (sizeof...(I) + J)...> type;
+};
+
+// 0 to N-1, split in halves so the template depth is log2(N)
+template<uint32_t N> struct RobotMakeIndices
+{
+    typedef typename RobotConcatIndices<typename RobotMakeIndices<N/2>::type,
+                                        typename RobotMakeIndices<N - N/2>::type>::type type;
+};
+template<> struct RobotMakeIndices<0> { typedef RobotIndices<> type; };
+template<> struct RobotMakeIndices<1> { typedef RobotIndices<0> type; };
+
+// e^x as 1 + x/1*(1 + x/2*(1 + ...)), exact in double for |x| <= 4
+constexpr double robotConstExpTerm(double x, int n)
+{
+    return n > 40 ? 1.0 : 1.0 + x / n * robotConstExpTerm(x, n + 1);
+}
+
+constexpr double robotConstExp(double x)
+{
+    return robotConstExpTerm(x, 1);
+}
+
+// logsc() with rolloff 19, (e^(p*ln 20) - 1) / 19
+constexpr float robotLogscPoint(double p)
+{
+    return (float)((robotConstExp(p * 2.99573227355399099344) - 1.0) / 19.0);
+}
+
+constexpr float robotWetPoint(double v)
+{
+    return (float)(1.0 - robotConstExp(-v) + 0.367879 * v);
+}
+
+template<uint32_t... I>
+constexpr RobotCurveTable robotLogscTable(RobotIndices<I...>)
+{
+    return RobotCurveTable{{ robotLogscPoint((double)I / RobotCurveTable::kSize)... }};
+}
+
+template<uint32_t... I>
+constexpr RobotCurveTable robotWetTable(RobotIndices<I...>)
+{
+    return RobotCurveTable{{ robotWetPoint((double)I / RobotCurveTable::kSize)... }};
+}
+
+static constexpr RobotCurveTable robotLogscCurve =
+    robotLogscTable(RobotMakeIndices<RobotCurveTable::kSize + 1>::type());
+static constexpr RobotCurveTable robotWetCurve =
+    robotWetTable(RobotMakeIndices<RobotCurveTable::kSize + 1>::type());
+
+// -----------------------------------------------------------------------
+
+/* 0-1 param to min-max on the logsc curve */
+static inline float robotLogsc(float param, float min, float max)
+{
+    return robotLogscCurve.lookup(param) * (max - min) + min;
+}
+
+/* 1 - e^-v + 0.367879*v, the wet curve for a 0-1 wet */
+static inline float robotWet(float value)
+{
+    return robotWetCurve.lookup(value);
+}
@@ -0,0 +1,185 @@
+#pragma once
+#include <cstdint>
+/*
+ * Decimation and interpolation by powers of 2, for running a filter at a
+ * lower rate while the rest of the plugin stays at the host rate
+ *
+ * Every stage is a polyphase IIR half band, two chains of first order
+ * allpasses at the lower rate whose mean is the low pass. 6 coefficients
+ * from the elliptic design of Valenzuela and Constantinides (as in hiir),
+ * transition band 0.2-0.3 of the higher rate, 80 dB down above it and
+ * flat to 5e-8 dB below. The phase is not linear, at low frequencies a
+ * stage delays by a few samples of its lower rate.
+ */
+class RobotHalfBand
+{
+public:
+    static const int kCoefs = 6;
+
+    void reset()
+    {
+        for (int i=0; i < kCoefs; ++i)
+            x1[i] = y1[i] = 0.0f;
+    }
+
+    // Two samples of the higher rate in, one of the lower rate out
+    inline float down(float first, float second)
+    {
+        return 0.5f*(path<0>(second) + path<1>(first));
+    }
+
+    // One sample of the lower rate in, two of the higher rate out
+    inline void up(float in, float& first, float& second)
+    {
+        first  = path<0>(in);
+        second = path<1>(in);
+    }
+
+private:
+    // Even coefficients make the first path, odd ones the second
+    template<int Path>
+    inline float path(float in)
+    {
+        static const float coefs[kCoefs] = {
+            0.060297390957f, 0.215971444561f, 0.412590720361f,
+            0.604358626466f, 0.772715653743f, 0.923886138653f
+        };
+        for (int i=Path; i < kCoefs; i += 2)
+        {
+            const float out = (in - y1[i])*coefs[i] + x1[i];
+            x1[i] = in;
+            y1[i] = out;
+            in    = out;
+        }
+        return in;
+    }
+
+    float x1[kCoefs] = {};
+    float y1[kCoefs] = {};
+};
+
+/*
+ * One channel down by 2^stages and back up. Stage k runs between the host
+ * rate over 2^k and over 2^(k+1), so changing the factor keeps the stages
+ * both factors use. The way back goes through a short delay line, 2^stages
+ * - 1 samples long, so the host can cut its buffers anywhere.
+ */
+class RobotRateChain
+{
+public:
+    static const int      kMaxStages = 3;
+    static const uint32_t kMaxFactor = 1 << kMaxStages;
+
+    // Clean stages, the delay line primed for the factor
+    void reset(int value)
+    {
+        for (int s=0; s < kMaxStages; ++s)
+        {
+            downStage[s].reset();
+            upStage[s].reset();
+            odd[s] = false;
+        }
+        stages = value;
+        prime();
+    }
+
+    /*
+     * A new factor at a group boundary. Stages the new factor adds start
+     * clean, the delay line starts over, so fade from a copy of the old
+     * chain.
+     */
+    void setStages(int value)
+    {
+        for (int s=stages; s < value; ++s)
+        {
+            downStage[s].reset();
+            upStage[s].reset();
+        }
+        for (int s=0; s < kMaxStages; ++s)
+            odd[s] = false;
+        stages = value;
+        prime();
+    }
+
+    int getStages() const
+    {
+        return stages;
+    }
+
+    // Host rate in, returns how many samples of the lower rate came out
+    uint32_t down(const float* in, float* out, uint32_t frames)
+    {
+        uint32_t m = 0;
+        for (uint32_t i=0; i < frames; ++i)
+        {
+            float v = in[i];
+            int s = 0;
+            for (; s < stages; ++s)
+            {
+                if (!odd[s])
+                {
+                    pending[s] = v;
+                    odd[s] = true;
+                    break;
+                }
+                odd[s] = false;
+                v = downStage[s].down(pending[s], v);
+            }
+            if (s == stages)
+                out[m++] = v;
+        }
+        return m;
+    }
+
+    // Lower rate in, every sample gives 2^stages for pop()
+    void up(const float* in, uint32_t frames)
+    {
+        for (uint32_t i=0; i < frames; ++i)
+        {
+            float a[kMaxFactor], b[kMaxFactor];
+            float* from = a;
+            float* to   = b;
+            uint32_t size = 1;
+            a[0] = in[i];
+            for (int s=stages-1; s >= 0; --s)
+            {
+                for (uint32_t k=0; k < size; ++k)
+                    upStage[s].up(from[k], to[2*k], to[2*k+1]);
+                size *= 2;
+                float* const t = from;
+                from = to;
+                to   = t;
+            }
+            for (uint32_t k=0; k < size; ++k)
+                ring[(head++) & (kRingSize-1)] = from[k];
+        }
+    }
+
+    void pop(float* out, uint32_t frames)
+    {
+        for (uint32_t i=0; i < frames; ++i)
+            out[i] = ring[(tail++) & (kRingSize-1)];
+    }
+
+private:
+    // Holds the delay and what up() gave for one micro-block of 32
+    static const uint32_t kRingSize = 64;
+
+    void prime()
+    {
+        head = tail = 0;
+        for (uint32_t k=1; k < (1u << stages); ++k)
+            ring[(head++) & (kRingSize-1)] = 0.0f;
+    }
+
+    RobotHalfBand downStage[kMaxStages];
+    RobotHalfBand upStage[kMaxStages];
+    // First sample of the pair a stage waits on
+    float pending[kMaxStages] = {};
+    bool  odd[kMaxStages] = {};
+    int   stages = 0;
+
+    float    ring[kRingSize];
+    uint32_t head = 0;
+    uint32_t tail = 0;
+};
@@ -0,0 +1,37 @@
+#pragma once
+#include <cmath>
+/*
+ * Branch free approximations that the compiler can vectorize
+ * when they are called from a loop over lanes
+ */
+
+/* atan, Abramowitz and Stegun 4.4.49 with 1/x folding outside [-1,1]
+ * max error about 2e-7
+ */
+static inline float fastAtan(float x)
+{
+    const float ax  = fabsf(x);
+    const bool  inv = ax > 1.0f;
+    const float z   = inv ? 1.0f/ax : ax;
+    const float z2  = z*z;
+    float p = z*(1.0f + z2*(-0.3333314528f + z2*(0.1999355085f + z2*(-0.1420889944f
+            + z2*(0.1065626393f + z2*(-0.0752896400f + z2*(0.0429096138f
+            + z2*(-0.0161657367f + z2*0.0028662257f))))))));
+    p = inv ? 1.5707963267948966f - p : p;
+    return copysignf(p, x);
+}
+
+/* atan, Abramowitz and Stegun 4.4.47 with the same folding, max error
+ * about 1e-5 for half the polynomial
+ */
+static inline float fastAtanCoarse(float x)
+{
+    const float ax  = fabsf(x);
+    const bool  inv = ax > 1.0f;
+    const float z   = inv ? 1.0f/ax : ax;
+    const float z2  = z*z;
+    float p = z*(0.9998660f + z2*(-0.3302995f + z2*(0.1801410f + z2*(-0.0851330f
+            + z2*0.0208351f))));
+    p = inv ? 1.5707963267948966f - p : p;
+    return copysignf(p, x);
+}
@@ -0,0 +1,117 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+/*
+ * Numerical health check
+ *
+ * Looks at the bit patterns so -ffast-math can not fold the NaN test away.
+ * With the sign bit cleared NaN and Inf have the largest patterns there
+ * are, so one integer compare per sample finds NaN, Inf and anything
+ * above the limit at once. Vectorizes with plain SSE2.
+ */
+inline bool robotIsHealthy(const float* values, uint32_t count, float limit)
+{
+    int32_t limitBits;
+    std::memcpy(&limitBits, &limit, sizeof(limitBits));
+
+    int32_t bad = 0;
+    for (uint32_t i=0; i < count; ++i)
+    {
+        int32_t bits;
+        std::memcpy(&bits, &values[i], sizeof(bits));
+        bad |= (bits & 0x7fffffff) > limitBits;
+    }
+    return bad == 0;
+}
+
+/*
+ * Per instance recovery, call process() at the end of run() with what was
+ * written and whether the filter state passed robotIsHealthy(). Every
+ * output sample comes out of that state, NaN or a runaway in the output
+ * leaves it in the state too, so checking a few floats per block is
+ * enough. A bad block is replaced by a ramp from the last good sample
+ * down to 0, the caller resets its filter state and the output fades
+ * back in from 0 so neither end of the restart clicks.
+ */
+class RobotHealth
+{
+public:
+    // +60 dBFS, far above anything a stable filter state reaches
+    static constexpr float kLimit = 1000.0f;
+    // Channels whose last good sample is kept for the fade out
+    static const uint32_t kMaxChannels = 2;
+
+    RobotHealth(double sampleRate, float fadeMs=10.0f)
+        : time(fadeMs)
+    {
+        setSampleRate(sampleRate);
+    }
+    void setSampleRate(double sampleRate)
+    {
+        fade = (uint32_t)(sampleRate*0.001*time);
+        if (fade == 0)
+            fade = 1;
+        reset();
+    }
+    // Starting over, no fade in and nothing to fade out from
+    void reset()
+    {
+        head = fade;
+        for (uint32_t c=0; c < kMaxChannels; ++c)
+            last[c] = 0.0f;
+    }
+    inline uint32_t getRecoveries() const
+    {
+        return recoveries;
+    }
+    /*
+     * Returns false when the state was bad, the outputs fade out to 0 by
+     * then and the state has to be reset before the next run().
+     */
+    bool process(float** outputs, uint32_t channels, uint32_t frames, bool healthy)
+    {
+        if (frames == 0)
+            return healthy;
+
+        if (!healthy)
+        {
+            // Nothing in the block can be trusted, it goes from where the
+            // last one ended down to 0 where the fade in starts
+            const float step = 1.0f/frames;
+            for (uint32_t c=0; c < channels; ++c)
+            {
+                const float from = c < kMaxChannels ? last[c] : 0.0f;
+                for (uint32_t i=0; i < frames; ++i)
+                    outputs[c][i] = from*(frames-1-i)*step;
+                if (c < kMaxChannels)
+                    last[c] = 0.0f;
+            }
+            head = 0;
+            ++recoveries;
+            return false;
+        }
+
+        if (head != fade)
+        {
+            // Fading back in after a recovery
+            const float step = 1.0f/fade;
+            for (uint32_t c=0; c < channels; ++c)
+            {
+                uint32_t h = head;
+                for (uint32_t i=0; i < frames && h != fade; ++i, ++h)
+                    outputs[c][i] *= h*step;
+            }
+            head = (fade-head > frames) ? head+frames : fade;
+        }
+        for (uint32_t c=0; c < channels && c < kMaxChannels; ++c)
+            last[c] = outputs[c][frames-1];
+        return true;
+    }
+private:
+    float    time;
+    uint32_t fade;
+    uint32_t head;
+    uint32_t recoveries = 0;
+    // Last sample of the last good block per channel
+    float    last[kMaxChannels] = {};
+};
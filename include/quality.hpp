@@ -0,0 +1,27 @@
+#pragma once
+#include <cstdint>
+/*
+ * Quality tiers of the Hexed filter. Moog has none, its cost is the 2x
+ * ladder and a 1x ladder is another filter, not a cheaper one
+ *
+ * Eco takes the cheap approximations and the lowest rate, High exact
+ * math everywhere. Normal is how the filters always sounded. A tier only
+ * changes how the same state is computed, so switching keeps the state
+ * and does not click.
+ */
+enum RobotQuality
+{
+    kQualityEco = 0,
+    kQualityNormal,
+    kQualityHigh,
+    kQualityCount
+};
+
+static const char* const robotQualityNames[kQualityCount] = { "Eco", "Normal", "High" };
+
+// Parameter values are floats from the host, round and clamp them
+static inline int robotQuality(float value)
+{
+    const int q = (int)(value + 0.5f);
+    return q < kQualityEco ? kQualityEco : (q > kQualityHigh ? kQualityHigh : q);
+}
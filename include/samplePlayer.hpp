@@ -41,6 +41,10 @@ public:
     {
         return samples;
     }
+    inline bool isIdle(float parameterValue)
+    {
+        return parameter==parameterValue && head==samples;
+    }
     float processBoolTrigger(float &in, bool &trigger)
     {
         if(trigger)
@@ -55,19 +59,27 @@ public:
         }
         else return 0.0f;
     }
-    float processChangeTrigger(float &in, float &parameterValue)
+    // True while the ramp after a change of parameterValue plays, the
+    // value itself may be 0 so it is not returned
+    bool processChangeTrigger(float &parameterValue)
     {
-        if(parameter!=parameterValue)
+        const bool changed = parameter!=parameterValue;
+        if(changed)
+        {
+            parameter=parameterValue;
             head=0;
+        }
         if(head!=samples)
         {
             head+=1;
-            return in;
+            return true;
         }
-        else return 0.0f;
+        else return changed;
     }
 private:
-    double time, parameter;
-    double sr;
+    // Per sample state first, time and sr only matter when set
+    float parameter;
     uint32_t samples, head;
+    double time;
+    double sr;
 };
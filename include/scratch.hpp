@@ -0,0 +1,83 @@
+#pragma once
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include "alignedNew.hpp"
+/*
+ * Temporary buffers for run(), one cache line aligned arena per plugin
+ *
+ * allocate() from activate() sizes it, run() starts with reset() and takes
+ * buffers with take(), which only moves an offset. Nothing is handed back
+ * on its own, the next reset() or the end of a Scope frees everything
+ * taken since. Taking more than was allocated asserts in debug builds.
+ */
+class RobotScratch
+{
+public:
+    static const size_t kAlign = 64;
+
+    // Gives back everything taken while it lives
+    class Scope
+    {
+    public:
+        explicit Scope(RobotScratch& scratch) : scratch(scratch), used(scratch.used) {}
+        ~Scope() { scratch.used = used; }
+    private:
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+        RobotScratch& scratch;
+        const size_t  used;
+    };
+
+    RobotScratch() {}
+
+    ~RobotScratch()
+    {
+        if (data != nullptr)
+            robotAlignedFree(data);
+    }
+
+    // Bytes take() uses for count values of T, to add up the size
+    template<class T>
+    static size_t bytes(size_t count)
+    {
+        return (count*sizeof(T) + kAlign-1) & ~(kAlign-1);
+    }
+
+    // Only reallocates to grow, so activating again at the same size is free
+    void allocate(size_t size)
+    {
+        used = 0;
+        if (size <= capacity)
+            return;
+        if (data != nullptr)
+            robotAlignedFree(data);
+        data     = nullptr;
+        capacity = 0;
+        data     = (uint8_t*)robotAlignedAlloc(size, kAlign);
+        capacity = size;
+    }
+
+    void reset()
+    {
+        used = 0;
+    }
+
+    template<class T>
+    T* take(size_t count)
+    {
+        const size_t size = bytes<T>(count);
+        assert(used + size <= capacity && "RobotScratch overflow, size it in activate()");
+        T* const ptr = (T*)(data + used);
+        used += size;
+        return ptr;
+    }
+
+private:
+    RobotScratch(const RobotScratch&) = delete;
+    RobotScratch& operator=(const RobotScratch&) = delete;
+
+    uint8_t* data = nullptr;
+    size_t   capacity = 0;
+    size_t   used = 0;
+};
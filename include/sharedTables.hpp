@@ -0,0 +1,125 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+/*
+ * Process wide tables, one immutable set per sample rate
+ *
+ * T is built from the sample rate on a thread of its own the first time
+ * a rate is asked for, and every instance at that rate gets the same
+ * build. The set is freed when the last instance lets go of it. Asking
+ * takes a lock, do it from activate() and never from run().
+ */
+template<class T>
+class RobotSharedTables
+{
+public:
+    // One T being built, done() turns true once and tables never changes after
+    class Build
+    {
+    public:
+        explicit Build(double rate)
+            : sampleRate(rate), thread(&Build::work, this) {}
+
+        ~Build()
+        {
+            thread.join();
+        }
+
+        bool done() const
+        {
+            return finished.load(std::memory_order_acquire);
+        }
+
+        const double sampleRate;
+        std::shared_ptr<const T> tables;
+
+    private:
+        void work()
+        {
+            tables = std::make_shared<const T>(sampleRate);
+            finished.store(true, std::memory_order_release);
+        }
+
+        std::atomic<bool> finished{false};
+        std::thread thread;
+    };
+
+    // The build for the rate, a new one if nobody has the rate yet
+    static std::shared_ptr<Build> acquire(double sampleRate)
+    {
+        std::lock_guard<std::mutex> lock(getMutex());
+        std::vector<Entry>& entries = getEntries();
+
+        std::shared_ptr<Build> build;
+        for (size_t i=0; i < entries.size();)
+        {
+            std::shared_ptr<Build> current = entries[i].build.lock();
+            if (!current)
+            {
+                // Nobody uses this rate anymore
+                entries[i] = entries.back();
+                entries.pop_back();
+                continue;
+            }
+            if (entries[i].sampleRate == sampleRate)
+                build = current;
+            ++i;
+        }
+        if (build)
+            return build;
+
+        build = std::make_shared<Build>(sampleRate);
+        Entry entry;
+        entry.sampleRate = sampleRate;
+        entry.build      = build;
+        entries.push_back(entry);
+        return build;
+    }
+
+private:
+    struct Entry
+    {
+        double sampleRate;
+        std::weak_ptr<Build> build;
+    };
+
+    static std::mutex& getMutex()
+    {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    static std::vector<Entry>& getEntries()
+    {
+        static std::vector<Entry> entries;
+        return entries;
+    }
+};
+
+/*
+ * An instance's hold on the tables for its rate. request() from activate()
+ * returns at once, get() is lock free and null until the set is built, the
+ * caller works the values out exactly meanwhile. Copies share the build,
+ * so copying one in run() never frees it.
+ */
+template<class T>
+class RobotTableSlot
+{
+public:
+    void request(double sampleRate)
+    {
+        if (!build || build->sampleRate != sampleRate)
+            build = RobotSharedTables<T>::acquire(sampleRate);
+    }
+
+    const T* get() const
+    {
+        return build && build->done() ? build->tables.get() : nullptr;
+    }
+
+private:
+    std::shared_ptr<typename RobotSharedTables<T>::Build> build;
+};
@@ -39,7 +39,9 @@ public:
         return z = (in * b) + (z * a);
     }
 private:
-    float a, b, t, z;
+    // Per sample state first, t and fs only matter in setSampleRate()
+    float a, b, z;
+    float t;
     double fs = 0.0;
 };
 
@@ -94,10 +96,10 @@ public:
 private:
     float start = 0.0f;
     float end = 0.0f;
-    double fs = 0.0;
-    double t = 0.0;
     uint32_t tick = 0;
     uint32_t tail = 0;
+    double fs = 0.0;
+    double t = 0.0;
 };
 
 
@@ -0,0 +1,47 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+/*
+ * Parameter values handed from the control thread to run()
+ *
+ * A seqlock, publish() makes the sequence odd, stores the values and makes
+ * it even again. take() copies them and checks that the sequence did not
+ * move, so run() never waits for the writer. A copy torn by a publish() in
+ * between is dropped and taken again at the next block. One writer at a
+ * time, hosts do not load two programs at once.
+ */
+template<uint32_t N>
+class RobotSnapshot
+{
+public:
+    void publish(const float* values)
+    {
+        const uint32_t seq = sequence.load(std::memory_order_relaxed);
+        sequence.store(seq+1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (uint32_t i=0; i < N; ++i)
+            data[i].store(values[i], std::memory_order_relaxed);
+        sequence.store(seq+2, std::memory_order_release);
+    }
+
+    // True with values from a publish() that was not taken yet
+    bool take(float* values)
+    {
+        const uint32_t seq = sequence.load(std::memory_order_acquire);
+        if (seq == taken || (seq & 1))
+            return false;
+        for (uint32_t i=0; i < N; ++i)
+            values[i] = data[i].load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence.load(std::memory_order_relaxed) != seq)
+            return false;
+        taken = seq;
+        return true;
+    }
+
+private:
+    std::atomic<uint32_t> sequence{0};
+    std::atomic<float>    data[N];
+    // Only run() writes this, keep it off the writers line
+    alignas(64) uint32_t  taken = 0;
+};
@@ -0,0 +1,33 @@
+#pragma once
+#include <cstdint>
+/*
+ * Work spread over worker threads from inside a process call
+ *
+ * Shaped after the CLAP thread-pool extension so a host's pool could back
+ * it, but DPF's CLAP wrapper does not forward clap_host_thread_pool and
+ * none of the plugins gets one. Only the tools hand in a RobotThreadPool,
+ * the plugins run their groups serially.
+ *
+ * exec() runs task(context, index) for every index below count, each
+ * index once and in any order on any thread, and only returns when all of
+ * them are done. It returns false when the tasks did not run, the caller
+ * then runs them itself. Tasks must only write their own part of the
+ * output.
+ */
+typedef void (*RobotTask)(void* context, uint32_t index);
+
+class RobotTaskPool
+{
+public:
+    virtual ~RobotTaskPool() {}
+    virtual bool exec(RobotTask task, void* context, uint32_t count) = 0;
+};
+
+// On the pool if there is one that takes the tasks, else in order here
+static inline void robotExec(RobotTaskPool* pool, RobotTask task, void* context, uint32_t count)
+{
+    if (count > 1 && pool != nullptr && pool->exec(task, context, count))
+        return;
+    for (uint32_t i=0; i < count; ++i)
+        task(context, i);
+}
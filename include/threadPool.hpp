@@ -0,0 +1,110 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "taskPool.hpp"
+/*
+ * RobotTaskPool on threads of its own, for the tools and benchmarks. The calling thread takes tasks too, so threads - 1
+ * workers are started. Workers sleep between calls, one exec() at a time.
+ */
+class RobotThreadPool : public RobotTaskPool
+{
+public:
+    explicit RobotThreadPool(uint32_t threads)
+    {
+        for (uint32_t t=1; t < threads; ++t)
+            workers.push_back(std::thread(&RobotThreadPool::work, this));
+    }
+
+    ~RobotThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quit = true;
+        }
+        wake.notify_all();
+        for (std::thread& worker : workers)
+            worker.join();
+    }
+
+    uint32_t getThreads() const
+    {
+        return (uint32_t)workers.size() + 1;
+    }
+
+    bool exec(RobotTask task, void* context, uint32_t count) override
+    {
+        if (workers.empty())
+            return false;
+        {
+            // A worker that woke after the last call took its tasks may
+            // still be on its way out, the job is not touched before it left
+            std::unique_lock<std::mutex> lock(mutex);
+            finished.wait(lock, [this] { return active == 0; });
+            jobTask    = task;
+            jobContext = context;
+            jobCount   = count;
+            next.store(0);
+            ++generation;
+        }
+        wake.notify_all();
+        run(task, context, count);
+
+        // Every task is taken, the ones still running are on workers
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [this] { return active == 0; });
+        return true;
+    }
+
+private:
+    void work()
+    {
+        uint64_t seen = 0;
+        for (;;)
+        {
+            RobotTask task;
+            void*     context;
+            uint32_t  count;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return quit || generation != seen; });
+                if (quit)
+                    return;
+                seen    = generation;
+                task    = jobTask;
+                context = jobContext;
+                count   = jobCount;
+                ++active;
+            }
+            run(task, context, count);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (--active == 0)
+                    finished.notify_one();
+            }
+        }
+    }
+
+    // Takes tasks until there are none left
+    void run(RobotTask task, void* context, uint32_t count)
+    {
+        for (uint32_t i = next.fetch_add(1); i < count; i = next.fetch_add(1))
+            task(context, i);
+    }
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake, finished;
+    bool     quit = false;
+    uint64_t generation = 0;
+
+    // The job, written and read under the mutex only
+    RobotTask jobTask = nullptr;
+    void*     jobContext = nullptr;
+    uint32_t  jobCount = 0;
+    // Workers inside run()
+    uint32_t  active = 0;
+    std::atomic<uint32_t> next{0};
+};
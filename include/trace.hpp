@@ -0,0 +1,189 @@
+#pragma once
+/*
+ * Real time trace recorder
+ *
+ * Built with make ROBOT_TRACE=true, otherwise the ROBOT_TRACE_* macros
+ * expand to nothing and no trace member exists. Events go into a fixed
+ * ring that is allocated up front, recording is one atomic add and a few
+ * stores so it can be called from run() and setParameterValue() on any
+ * thread. The oldest events are overwritten when the ring is full.
+ *
+ * writeChromeTrace() writes the ring as Chrome trace JSON for Perfetto or
+ * chrome://tracing, call it from a non real time thread. If the
+ * environment variable ROBOT_TRACE_DIR is set every instance writes
+ * <dir>/<name>-<id>.json when it is destroyed.
+ */
+#ifdef ROBOT_TRACE
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+
+class RobotTrace
+{
+public:
+    enum Event
+    {
+        kBlockBegin = 0,  // value is the frame count
+        kBlockEnd,
+        kParameter,       // index and value of the parameter
+        kCoefficients,    // value is recomputations in the block
+        kSleep,           // index is how many changed, value how many are awake
+        kWake,
+        kRecover,         // value is the recovery count
+        kProgram,         // value is the crossfade length, 0 while asleep
+        kRate             // value is the decimation factor
+    };
+
+    static const uint32_t kSize = 1 << 16;
+
+    explicit RobotTrace(const char* traceName)
+        : name(traceName),
+          id(nextId()),
+          ring(new Entry[kSize]),
+          start(std::chrono::steady_clock::now())
+    {
+        for (uint32_t i=0; i < kSize; ++i)
+            ring[i].seq.store(0, std::memory_order_relaxed);
+    }
+
+    ~RobotTrace()
+    {
+        const char* dir = std::getenv("ROBOT_TRACE_DIR");
+        if (dir == nullptr || dir[0] == '\0')
+            return;
+
+        char path[1024];
+        std::snprintf(path, sizeof(path), "%s/%s-%u.json", dir, name, id);
+        if (FILE* file = std::fopen(path, "w"))
+        {
+            writeChromeTrace(file);
+            std::fclose(file);
+        }
+    }
+
+    inline void record(Event event, uint32_t index, float value)
+    {
+        const uint32_t pos = head.fetch_add(1, std::memory_order_relaxed);
+        Entry& entry = ring[pos & (kSize-1)];
+
+        // Odd sequence while the entry is being written
+        entry.seq.store(2*pos + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        entry.time  = now();
+        entry.index = index;
+        entry.value = value;
+        entry.event = event;
+        entry.seq.store(2*pos + 2, std::memory_order_release);
+    }
+
+    void writeChromeTrace(FILE* file) const
+    {
+        const uint32_t end   = head.load(std::memory_order_acquire);
+        const uint32_t begin = end > kSize ? end - kSize : 0;
+
+        std::fprintf(file, "{\"traceEvents\":[\n");
+        std::fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,"
+                           "\"args\":{\"name\":\"%s %u\"}}", id, name, id);
+
+        for (uint32_t pos=begin; pos != end; ++pos)
+        {
+            const Entry& entry = ring[pos & (kSize-1)];
+            if (entry.seq.load(std::memory_order_acquire) != 2*pos + 2)
+                continue;
+            const uint64_t time  = entry.time;
+            const uint32_t index = entry.index;
+            const float    value = entry.value;
+            const uint32_t event = entry.event;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            // Overwritten while copying
+            if (entry.seq.load(std::memory_order_relaxed) != 2*pos + 2)
+                continue;
+            writeEvent(file, event, index, value, time);
+        }
+        std::fprintf(file, "\n]}\n");
+    }
+
+private:
+    struct Entry
+    {
+        std::atomic<uint32_t> seq;
+        uint64_t time;
+        uint32_t index;
+        float    value;
+        uint32_t event;
+    };
+
+    static uint32_t nextId()
+    {
+        static std::atomic<uint32_t> counter(0);
+        return ++counter;
+    }
+
+    inline uint64_t now() const
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count();
+    }
+
+    void writeEvent(FILE* file, uint32_t event, uint32_t index, float value, uint64_t time) const
+    {
+        const double ts = time * 0.001;
+
+        switch (event)
+        {
+        case kBlockBegin:
+            std::fprintf(file, ",\n{\"name\":\"run\",\"ph\":\"B\",\"ts\":%.3f,\"pid\":1,\"tid\":%u,"
+                               "\"args\":{\"frames\":%u}}", ts, id, (uint32_t)value);
+            break;
+        case kBlockEnd:
+            std::fprintf(file, ",\n{\"name\":\"run\",\"ph\":\"E\",\"ts\":%.3f,\"pid\":1,\"tid\":%u}", ts, id);
+            break;
+        case kParameter:
+            std::fprintf(file, ",\n{\"name\":\"parameter %u\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":1,\"tid\":%u,"
+                               "\"args\":{\"value\":%g}}", index, ts, id, value);
+            break;
+        case kCoefficients:
+            std::fprintf(file, ",\n{\"name\":\"%s %u coefficients\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,"
+                               "\"args\":{\"recomputed\":%g}}", name, id, ts, value);
+            break;
+        case kSleep:
+        case kWake:
+            std::fprintf(file, ",\n{\"name\":\"%s %u\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":1,\"tid\":%u,"
+                               "\"args\":{\"value\":%g}}", event == kSleep ? "sleep" : "wake",
+                               index, ts, id, value);
+            break;
+        case kRecover:
+            std::fprintf(file, ",\n{\"name\":\"recover\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":1,\"tid\":%u,"
+                               "\"args\":{\"recoveries\":%g}}", ts, id, value);
+            break;
+        case kProgram:
+            std::fprintf(file, ",\n{\"name\":\"program\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":1,\"tid\":%u,"
+                               "\"args\":{\"fade\":%g}}", ts, id, value);
+            break;
+        case kRate:
+            std::fprintf(file, ",\n{\"name\":\"rate\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":1,\"tid\":%u,"
+                               "\"args\":{\"factor\":%g}}", ts, id, value);
+            break;
+        }
+    }
+
+    const char* const name;
+    const uint32_t id;
+    std::unique_ptr<Entry[]> ring;
+    std::atomic<uint32_t> head{0};
+    const std::chrono::steady_clock::time_point start;
+};
+
+#define ROBOT_TRACE_DECLARE(traceName) RobotTrace fTrace{traceName};
+#define ROBOT_TRACE_EVENT(event, index, value) fTrace.record(RobotTrace::event, index, value)
+
+#else
+
+#define ROBOT_TRACE_DECLARE(traceName)
+#define ROBOT_TRACE_EVENT(event, index, value) ((void)(index), (void)(value))
+
+#endif // ROBOT_TRACE
@@ -1,5 +1,6 @@
 #pragma once
 #include <cmath>
+#include "curves.hpp"
 /*
  * Simpler Wet
  * I thought that setWet(float float) sounded better
@@ -14,7 +15,7 @@ public:
     }
     inline void setWet(float value)
     {
-        wet = 1.0 - exp(-value) + 0.367879*value;
+        wet = robotWet(value);
     }
     inline void setLinearWet(float value)
     {
@@ -22,9 +22,15 @@
  *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 #include "RobotHexedFilterDSP.hpp"
+#include <cstddef>
+#include "health.hpp"
+#include "curves.hpp"
+#include "fastmath.hpp"
 RobotHexedFilterDSP::RobotHexedFilterDSP(double sampleRate, float cutoff, float resonance, float mode)
-    : sr(sampleRate)  
 {
+    // The rate first, setCutOff() works from it. The table still waits
+    // for flush()
+    setRate(sampleRate);
     setCutOff(cutoff);
     setResonance(resonance);
     setMode(mode);
@@ -32,16 +38,28 @@ RobotHexedFilterDSP::RobotHexedFilterDSP(double sampleRate, float cutoff, float
 void RobotHexedFilterDSP::setCutOff(float value)
 {
     cutoffNorm   = logsc(value,60,19000);
+    updateCutOff();
+}
+
+// Coefficients from cutoffNorm at the current rate
+void RobotHexedFilterDSP::updateCutOff()
+{
     g            = (float)tan(cutoffNorm * srateInv * PI_F);
     br           = bright - ((bright-1)*(1.0-((cutoffNorm-60)*0.000000016)));
     lpc          = g / (1 + g);
+    brl          = br / (1 + br);
+    // Only the bright filter follows the cutoff and brl moves by about
+    // 1e-4 over the whole range, so a sweep rebuilds the pre filter
+    // blocks once it has gone kPreTolerance from the one they were built for
+    if (fabsf(brl - preBrl) > kPreTolerance*preBrl)
+        preDirty = true;
 }
 
 void RobotHexedFilterDSP::setResonance(float value)
 {
     rReso       = (0.991-logsc(1-value, 0, 0.991));
     R24         =  3.7 * rReso;
-
+    outGain     = ( 1 + R24 * 0.45 ) * (1-(mm_balancer*rReso*0.96422));
 }
 inline float RobotHexedFilterDSP::modeLower(float value)
 {
@@ -63,9 +81,13 @@ void RobotHexedFilterDSP::setMode(float value) // range 1-4 but should go toward
     value==2.0f ? mmt_y2 = 1.0f : mmt_y2 = 0.0f;
     value==3.0f ? mmt_y3 = 1.0f : mmt_y3 = 0.0f;
     value==4.0f ? mmt_y4 = 1.0f : mmt_y4 = 0.0f;
-    // if it was exact return
+    // if it was exact use the pure pole kernel and return
     if(remain==0)
+    {
+        kernel = offset;
         return;
+    }
+    kernel = 0;
     // Parallel mix
     switch (offset)
     {
@@ -99,30 +121,61 @@ float RobotHexedFilterDSP::responseDb(float scaledFreq) const
 
 void RobotHexedFilterDSP::flush(double srate)
 {
-    sr = (float)srate;
-    srateInv = 1/srate;
+    static_assert(offsetof(RobotHexedFilterDSP, hpc) + sizeof(float) <= 64,
+                  "Per sample state must fit one cache line");
+    // The table comes later for a new rate, cutOffToG() is exact until then
+    tables.request(srate);
+    setRate(srate);
 
     s1=s2=s3=s4=c=d=0;
 
     R24=0;
+    outGain = 1-(mm_balancer*rReso*0.96422);
 
     mmt_y1=mmt_y2=mmt_y3=mmt_y4=0; 
+    kernel=0;
+
+    dc_tmp = 0;
+}
+
+/*
+ * Rate constants and the cutoff coefficients for another rate, the state
+ * stays. For running decimated, it takes no lock and cutOffToG() keeps
+ * the table of the last flush().
+ */
+void RobotHexedFilterDSP::setRate(double srate)
+{
+    const RobotHexedRate rate(srate);
+
+    srateInv = rate.srateInv;
+    hpc      = (15 * srateInv)* PI_F;
+    hpl      = hpc / (1 + hpc);
 
-    float rcrate = sqrt((44000/srate));
-    rcor24 = (970.0/44000)*rcrate;
-    rcor24Inv = 1/rcor24;
+    rcor24    = rate.rcor24;
+    rcor24Inv = rate.rcor24Inv;
+    bright    = rate.bright;
+    dc_r      = rate.dc_r;
+
+    preDirty  = true;
+    updateCutOff();
+}
 
-    bright =  (sin((44000/srate)*(43900/44000) * PI_F * srateInv))/
-              (cos((44000/srate)*(43900/44000) * PI_F * srateInv));
+bool RobotHexedFilterDSP::isHealthy(float limit) const
+{
+    const float state[7] = { s1, s2, s3, s4, c, d, dc_tmp };
+    return robotIsHealthy(state, 7, limit);
+}
 
-    dc_r = 1.0-(126.0/srate);
+void RobotHexedFilterDSP::reset()
+{
+    s1=s2=s3=s4=c=d=0;
     dc_tmp = 0;
 }
 
 
-float RobotHexedFilterDSP::logsc(float param, const float min, const float max, const float rolloff)
+float RobotHexedFilterDSP::logsc(float param, const float min, const float max)
 {
-    return ((expf(param * logf(rolloff+1)) - 1.0f) / (rolloff)) * (max-min) + min;
+    return robotLogsc(param, min, max);
 }
 
 float RobotHexedFilterDSP::tptpc(float& state, float inp, float cutoff)
@@ -142,34 +195,400 @@ float RobotHexedFilterDSP::NR24(float sample, float g, float lpc)
     return y + 1e-8;
 }
 
-float RobotHexedFilterDSP::process(float x)
+/*
+ * Cheap version of setCutOff() for audio rate modulation, returns g for
+ * a 0-1 cutoff without touching the filter. Reads the shared table for
+ * the current rate, good to about 2.5e-5, and falls back to
+ * cutOffToGExact() while the table for a new rate is being built.
+ */
+float RobotHexedFilterDSP::cutOffToG(float value) const
+{
+    if (const RobotHexedTables* const table = tables.get())
+        return table->lookupG(value);
+    return cutOffToGExact(value);
+}
+
+void RobotHexedFilterDSP::cutOffToG(const float* value, float* gOut, uint32_t frames) const
+{
+    const RobotHexedTables* const table = tables.get();
+    if (table == nullptr)
+    {
+        cutOffToGExact(value, gOut, frames);
+        return;
+    }
+    for (uint32_t i=0; i < frames; ++i)
+        gOut[i] = table->lookupG(value[i]);
+}
+
+float RobotHexedFilterDSP::cutOffToGExact(float value) const
+{
+    if (value < 0.0f) value = 0.0f;
+    if (value > 1.0f) value = 1.0f;
+    double w = robotLogsc(value,60,19000) * srateInv * PI_F;
+    // keep away from the tan pole at low sample rates, like the table
+    if (w > 1.5) w = 1.5;
+    return (float)tan(w);
+}
+
+void RobotHexedFilterDSP::cutOffToGExact(const float* value, float* gOut, uint32_t frames) const
+{
+    for (uint32_t i=0; i < frames; ++i)
+        gOut[i] = cutOffToGExact(value[i]);
+}
+
+// DC blocker, 15 Hz cut and bright filter for one sample
+inline float RobotHexedFilterDSP::preFilter(float x)
 {
     // Simple DC filter
     float dc_prev = x;
                 x = x - dc_tmp + dc_r * dc_tmp;
            dc_tmp = dc_prev;
     // Remove a bit under 15
-                x = x - 0.45*tptpc(c, x, (15 * srateInv)* PI_F);
+    float v = (x - c) * hpl;
+    float y = v + c;
+    c       = y + v;
+    x       = x - 0.45f*y;
     // Add bright value..
-                x = tptpc(d, x, br);
-
-    // All states in a recursive composite pre order
-    // controlled by resonance
-    // add dc back
-         float y0 = NR24(x, g, lpc);
-
-    // First low pass in cascade
-    double res = tptpc(s1,y0,g);
-    // Damping
-    s1       = atan(s1*rcor24)*rcor24Inv;
-    float y1 = res;
-    float y2 = tptpc(s2,y1,g);
-    float y3 = tptpc(s3,y2,g);
-    float y4 = tptpc(s4,y3,g);
-    // Multi-mode mixer
+    v = (x - d) * brl;
+    x = v + d;
+    d = x + v;
+    return x;
+}
+
+/*
+ * Per sample the three filters are the state s = (dc_tmp, c, d) with
+ *     y = C s + D x,    s' = A s + B x
+ * so over a block of kPreBlock samples output j is C A^j s plus the
+ * impulse response C A^(j-1-i) B (D for i = j) times each earlier input i.
+ * Worked out in double after flush() and once the cutoff has moved far
+ * enough, see updateCutOff().
+ */
+void RobotHexedFilterDSP::updatePre()
+{
+    const double k  = dc_r - 1.0;
+    const double a1 = 1.0 - 0.45*hpl;
+    const double a2 = -0.45*(1.0 - hpl);
+    const double A[3][3] = {
+        { 0.0,             0.0,           0.0          },
+        { 2.0*hpl*k,       1.0 - 2.0*hpl, 0.0          },
+        { 2.0*brl*a1*k,    2.0*brl*a2,    1.0 - 2.0*brl } };
+    const double B[3] = { 1.0, 2.0*hpl, 2.0*brl*a1 };
+
+    // C A^j, one row per output of the block
+    double row[3] = { brl*a1*k, brl*a2, 1.0 - brl };
+    preImpulse[0] = (float)(brl*a1);
+    for (uint32_t j=0; j < kPreBlock; ++j)
+    {
+        for (int i=0; i < 3; ++i)
+            preFromState[i][j] = (float)row[i];
+        if (j + 1 < kPreBlock)
+            preImpulse[j + 1] = (float)(row[0]*B[0] + row[1]*B[1] + row[2]*B[2]);
+        double next[3];
+        for (int i=0; i < 3; ++i)
+            next[i] = row[0]*A[0][i] + row[1]*A[1][i] + row[2]*A[2][i];
+        for (int i=0; i < 3; ++i)
+            row[i] = next[i];
+    }
+
+    // A^m B lands in the inputs m samples before the end, A^kPreBlock in the states
+    double power[3][3] = { { 1.0, 0.0, 0.0 }, { 0.0, 1.0, 0.0 }, { 0.0, 0.0, 1.0 } };
+    for (uint32_t m=0; m < kPreBlock; ++m)
+    {
+        const uint32_t i = 3 + kPreBlock-1 - m;
+        preC[i] = (float)(power[1][0]*B[0] + power[1][1]*B[1] + power[1][2]*B[2]);
+        preD[i] = (float)(power[2][0]*B[0] + power[2][1]*B[1] + power[2][2]*B[2]);
+        double next[3][3];
+        for (int r=0; r < 3; ++r)
+            for (int col=0; col < 3; ++col)
+                next[r][col] = A[r][0]*power[0][col] + A[r][1]*power[1][col] + A[r][2]*power[2][col];
+        for (int r=0; r < 3; ++r)
+            for (int col=0; col < 3; ++col)
+                power[r][col] = next[r][col];
+    }
+    for (int i=0; i < 3; ++i)
+    {
+        preC[i] = (float)power[1][i];
+        preD[i] = (float)power[2][i];
+    }
+    preBrl   = brl;
+    preDirty = false;
+}
+
+/*
+ * The filters over a whole buffer. Each block of kPreBlock outputs is a
+ * sum of independent products the compiler keeps in one vector, only
+ * the states carry from block to block. in and out may be the same.
+ */
+void RobotHexedFilterDSP::preFilter(const float* in, float* out, uint32_t frames)
+{
+    if (preDirty)
+        updatePre();
+
+    // Everything in locals, out could point at a member as far as the
+    // compiler knows and would reload them after every store
+    alignas(16) float fromState[3][kPreBlock];
+    alignas(16) float fromInput[kPreBlock][kPreBlock];
+    float toC[3 + kPreBlock], toD[3 + kPreBlock];
+    for (uint32_t i=0; i < 3; ++i)
+        for (uint32_t j=0; j < kPreBlock; ++j)
+            fromState[i][j] = preFromState[i][j];
+    // The impulse shifted down by each input, so every input is one vector
+    for (uint32_t i=0; i < kPreBlock; ++i)
+        for (uint32_t j=0; j < kPreBlock; ++j)
+            fromInput[i][j] = 0.0f;
+    for (uint32_t i=0; i < kPreBlock; ++i)
+        for (uint32_t j=i; j < kPreBlock; ++j)
+            fromInput[i][j] = preImpulse[j - i];
+    for (uint32_t i=0; i < 3 + kPreBlock; ++i)
+    {
+        toC[i] = preC[i];
+        toD[i] = preD[i];
+    }
+    float u = dc_tmp, sc = c, sd = d;
+
+    uint32_t n = 0;
+    for (; n + kPreBlock <= frames; n += kPreBlock)
+    {
+        float x[kPreBlock];
+        float y[kPreBlock];
+        for (uint32_t i=0; i < kPreBlock; ++i)
+            x[i] = in[n + i];
+        for (uint32_t j=0; j < kPreBlock; ++j)
+            y[j] = fromState[0][j]*u + fromState[1][j]*sc + fromState[2][j]*sd;
+        for (uint32_t i=0; i < kPreBlock; ++i)
+            for (uint32_t j=0; j < kPreBlock; ++j)
+                y[j] += fromInput[i][j]*x[i];
+
+        float cNext = toC[0]*u + toC[1]*sc + toC[2]*sd;
+        float dNext = toD[0]*u + toD[1]*sc + toD[2]*sd;
+        for (uint32_t i=0; i < kPreBlock; ++i)
+        {
+            cNext += toC[3 + i]*x[i];
+            dNext += toD[3 + i]*x[i];
+        }
+        sc = cNext;
+        sd = dNext;
+        u  = x[kPreBlock-1];
+
+        for (uint32_t j=0; j < kPreBlock; ++j)
+            out[n + j] = y[j];
+    }
+    dc_tmp = u;
+    c      = sc;
+    d      = sd;
+    for (; n < frames; ++n)
+        out[n] = preFilter(in[n]);
+}
+
+// x has been through preFilter()
+template<int Mode, bool Fast>
+inline float RobotHexedFilterDSP::processKernel(float x, float g, float lpc)
+{
+    float y1, y2, y3, y4;
+    if (Fast)
+    {
+        // Float with the gains precomputed, no divisions besides NR24
+        // and the coarse atan for the damping
+        const float y0 = NR24(x, g, lpc);
+
+        float v = (y0 - s1) * lpc;
+        y1 = v + s1;
+        s1 = fastAtanCoarse((y1 + v)*rcor24)*rcor24Inv;
+        v  = (y1 - s2) * lpc;
+        y2 = v + s2;
+        s2 = y2 + v;
+        v  = (y2 - s3) * lpc;
+        y3 = v + s3;
+        s3 = y3 + v;
+        v  = (y3 - s4) * lpc;
+        y4 = v + s4;
+        s4 = y4 + v;
+    }
+    else
+    {
+        // All states in a recursive composite pre order
+        // controlled by resonance
+        // add dc back
+        float y0 = NR24(x, g, lpc);
+
+        // First low pass in cascade
+        double res = tptpc(s1,y0,g);
+        // Damping
+        s1 = atan(s1*rcor24)*rcor24Inv;
+        y1 = res;
+        // Every stage feeds NR24 next sample so they all run even when
+        // only an earlier one is heard
+        y2 = tptpc(s2,y1,g);
+        y3 = tptpc(s3,y2,g);
+        y4 = tptpc(s4,y3,g);
+    }
+    return mixModes<Mode>(y1, y2, y3, y4);
+}
+
+// Multi-mode mixer, pure modes pick one tap and skip it
+template<int Mode>
+inline float RobotHexedFilterDSP::mixModes(float y1, float y2, float y3, float y4) const
+{
+    switch (Mode)
+    {
+        case 1: return y1 * outGain;
+        case 2: return y2 * outGain;
+        case 3: return y3 * outGain;
+        case 4: return y4 * outGain;
+    }
     float mc = mmt_y1*y1 + mmt_y2*y2 + mmt_y3*y3 + mmt_y4*y4;
-    return (mc * ( 1 + R24 * 0.45 )) * (1-(mm_balancer*rReso*0.96422));
+    return mc * outGain;
+}
+
+/*
+ * Below kLinearLimit atan(u) is u - u^3/3, so the damping of s1 changes
+ * it by less than 3e-6 of itself and the core is four plain one poles.
+ * Only tried up to about half resonance, past that the feedback builds
+ * the difference up and it gets louder than -110 dB.
+ */
+static const float kLinearLimit  = 0.003f;
+static const float kLinearMaxR24 = 3.0f;
+
+// Cheap test before processLinear(), nothing near the limit at the start
+bool RobotHexedFilterDSP::linearFits(const float* x, uint32_t frames) const
+{
+    if (R24 > kLinearMaxR24)
+        return false;
+    float peak = fmaxf(fmaxf(fabsf(s1), fabsf(s2)), fmaxf(fabsf(s3), fabsf(s4)));
+    for (uint32_t i=0; i < frames; ++i)
+        peak = fmaxf(peak, fabsf(x[i]));
+    return peak*rcor24 <= kLinearLimit;
+}
+
+/*
+ * The core over x with the damping left out, no atan and no double. Stops
+ * before the first sample that would take s1 past the limit and returns
+ * how many it did, processKernel() carries on from there with the same
+ * states, so the switch is seamless.
+ */
+template<int Mode, bool Fast>
+uint32_t RobotHexedFilterDSP::processLinear(const float* gMod, float* x, uint32_t frames)
+{
+    // fastAtanCoarse() has this slope at 0, atan() has 1
+    const float slope = Fast ? 0.9998660f : 1.0f;
+    const float limit = kLinearLimit * rcor24Inv;
+    const float r24   = R24;
+    // Locals, x could alias the states as far as the compiler knows
+    float a1 = s1, a2 = s2, a3 = s3, a4 = s4;
+
+    uint32_t i = 0;
+    for (; i < frames; ++i)
+    {
+        const float gi   = gMod != nullptr ? gMod[i] : g;
+        const float lpci = gMod != nullptr ? gMod[i] / (1 + gMod[i]) : lpc;
+
+        // NR24
+        const float S  = (lpci*(lpci*(lpci*a1+a2)+a3)+a4) / (1+gi);
+        const float G  = lpci*lpci*lpci*lpci;
+        const float y0 = (x[i] - r24*S) / (1 + r24*G) + 1e-8f;
+
+        float v  = (y0 - a1) * lpci;
+        const float y1 = v + a1;
+        const float u  = y1 + v;
+        if (fabsf(u) > limit)
+            break;
+        a1 = u * slope;
+        v  = (y1 - a2) * lpci;
+        const float y2 = v + a2;
+        a2 = y2 + v;
+        v  = (y2 - a3) * lpci;
+        const float y3 = v + a3;
+        a3 = y3 + v;
+        v  = (y3 - a4) * lpci;
+        const float y4 = v + a4;
+        a4 = y4 + v;
+
+        x[i] = mixModes<Mode>(y1, y2, y3, y4);
+    }
+    s1 = a1; s2 = a2; s3 = a3; s4 = a4;
+    return i;
 }
 
+template<int Mode, bool Fast>
+void RobotHexedFilterDSP::processBlock(const float* in, const float* gMod, float* out, uint32_t frames)
+{
+    // The linear part first, then the core in place over it
+    preFilter(in, out, frames);
+
+    // Quiet blocks start on the linear core and may finish on the full one
+    uint32_t i = 0;
+    if (linearFits(out, frames))
+        i = processLinear<Mode, Fast>(gMod, out, frames);
+
+    if (gMod == nullptr)
+    {
+        for (; i < frames; ++i)
+            out[i] = processKernel<Mode, Fast>(out[i], g, lpc);
+        return;
+    }
+    for (; i < frames; ++i)
+        out[i] = processKernel<Mode, Fast>(out[i], gMod[i], gMod[i] / (1 + gMod[i]));
+}
+
+template<bool Fast>
+void RobotHexedFilterDSP::processBlock(const float* in, const float* gMod, float* out, uint32_t frames)
+{
+    // Mode is fixed for the whole block so dispatch once
+    switch (kernel)
+    {
+        case 1:  processBlock<1, Fast>(in, gMod, out, frames); break;
+        case 2:  processBlock<2, Fast>(in, gMod, out, frames); break;
+        case 3:  processBlock<3, Fast>(in, gMod, out, frames); break;
+        case 4:  processBlock<4, Fast>(in, gMod, out, frames); break;
+        default: processBlock<0, Fast>(in, gMod, out, frames); break;
+    }
+}
+
+float RobotHexedFilterDSP::process(float x)
+{
+    return process(x, g, lpc);
+}
+
+float RobotHexedFilterDSP::process(float x, float gMod)
+{
+    return process(x, gMod, gMod / (1 + gMod));
+}
+
+float RobotHexedFilterDSP::process(float x, float g, float lpc)
+{
+    x = preFilter(x);
+    if (fast)
+    {
+        switch (kernel)
+        {
+            case 1:  return processKernel<1, true>(x, g, lpc);
+            case 2:  return processKernel<2, true>(x, g, lpc);
+            case 3:  return processKernel<3, true>(x, g, lpc);
+            case 4:  return processKernel<4, true>(x, g, lpc);
+            default: return processKernel<0, true>(x, g, lpc);
+        }
+    }
+    switch (kernel)
+    {
+        case 1:  return processKernel<1, false>(x, g, lpc);
+        case 2:  return processKernel<2, false>(x, g, lpc);
+        case 3:  return processKernel<3, false>(x, g, lpc);
+        case 4:  return processKernel<4, false>(x, g, lpc);
+        default: return processKernel<0, false>(x, g, lpc);
+    }
+}
+
+void RobotHexedFilterDSP::process(const float* in, float* out, uint32_t frames)
+{
+    process(in, nullptr, out, frames);
+}
+
+void RobotHexedFilterDSP::process(const float* in, const float* gMod, float* out, uint32_t frames)
+{
+    if (fast)
+        processBlock<true>(in, gMod, out, frames);
+    else
+        processBlock<false>(in, gMod, out, frames);
+}
 
 // -----------------------------------------------------------------------
@@ -23,6 +23,9 @@
  */
 #pragma once
 #include <cmath>
+#include <cstdint>
+#include <memory>
+#include "RobotHexedTables.hpp"
 
 #define PI_F 3.1415927410125732421875f
 #define E_F  2.7182818284590452353602f
@@ -30,43 +33,108 @@
 class RobotHexedFilterDSP
 {
 public:
+    // Nothing set up, flush() before the first process()
+    RobotHexedFilterDSP() {}
     RobotHexedFilterDSP(double sr, float cutoff =1.0f, float resonance=0.0f, float mode=4.0f);
     float process(float x);
+    void  process(const float* in, float* out, uint32_t frames);
+    // Audio rate cutoff, gMod comes from cutOffToG() per sample
+    float process(float x, float gMod);
+    void  process(const float* in, const float* gMod, float* out, uint32_t frames);
+    float cutOffToG(float value) const;
+    void  cutOffToG(const float* value, float* gOut, uint32_t frames) const;
+    // Same with tan() per value instead of the table
+    float cutOffToGExact(float value) const;
+    void  cutOffToGExact(const float* value, float* gOut, uint32_t frames) const;
     float responseDb(float scaledFreq) const;
     void setCutOff(float value);
+    // g from the last setCutOff()
+    float getG() const { return g; }
     void setResonance(float value);
     void setMode(float value);
+    // Float math and fastAtanCoarse instead of double and atan, state is the same
+    void setFast(bool value) { fast = value; }
     void flush(double sr);
+    // New rate for the coefficients only, keeps the state
+    void setRate(double sr);
+    // False if any state is NaN, Inf or above limit
+    bool isHealthy(float limit) const;
+    // Clears the filter state and keeps every coefficient
+    void reset();
 protected:
 // -------------------------------------------------------------------
-// Dsp 
-    
-    float rReso;
-    float cutoffNorm;
-    float g; //
-    float lpc;
-    float br;
+// Dsp
+//
+// Everything the kernel reads or writes each sample sits in the first
+// cache line, config that only changes with a parameter comes after it.
 
-    float sr;
-    float srateInv;
-    float s1,s2,s3,s4;
-    float d, c;
-    float R24;
-    float rcor24,rcor24Inv;
-    float bright;
-    float mm_balancer = 0.7578f;
-    
-    // 24 db multimode
-    int   mmch=4;
+    // Filter state
+    alignas(64) float s1=0.0f;
+    float s2=0.0f, s3=0.0f, s4=0.0f;
+    float d=0.0f, c=0.0f;
+    float dc_tmp=0.0f;
+    // Per sample coefficients, a default constructed filter holds these
+    // until flush() sets the rate
+    float g=0.0f; //
+    float lpc=0.0f;
+    float br=0.0f;
+    float R24=0.0f;
+    // Output gain from resonance and balancer, only changes with setResonance()
+    float outGain=1.0f;
+    float rcor24=0.0f,rcor24Inv=0.0f;
+    float dc_r=0.0f;
+    // 15 Hz high pass before the bright filter
+    float hpc=0.0f;
+
+    // 24 db multimode, only read by the crossfade kernel
     float mmt_y1=0.0f, mmt_y2=0.0f, mmt_y3=0.0f, mmt_y4=1.0f;
+    // Kernel picked by setMode(), 1-4 is a pure pole mode and 0 crossfades
+    int   kernel=4;
+    bool  fast=false;
+    // The pre filter blocks are out of date with the cutoff or rate
+    bool  preDirty=true;
+
+    float rReso=0.0f;
+    float cutoffNorm=19000.0f;
+    // brl the pre filter blocks were built for
+    float preBrl=0.0f;
+    float srateInv=0.0f;
+    float bright=0.0f;
+    float mm_balancer = 0.7578f;
+
+    // Cutoff to g table for the rate, shared by every instance
+    RobotTableSlot<RobotHexedTables> tables;
 
-    float dc_tmp;
-    float dc_r;
-    
+    // The DC blocker, 15 Hz and bright filters are linear, processBlock()
+    // runs them as one three state section kPreBlock samples at a time.
+    // What each output of a block gets from the states (dc_tmp, c, d) at
+    // its start and from the inputs so far, set by updatePre().
+    static const uint32_t kPreBlock = 4;
+    // How far brl may move, relative, before the blocks are rebuilt
+    static constexpr float kPreTolerance = 1e-6f;
+    alignas(16) float preFromState[3][kPreBlock] = {};
+    alignas(16) float preImpulse[kPreBlock] = {};
+    // c and d after a block from the states and the inputs
+    float preC[3 + kPreBlock] = {};
+    float preD[3 + kPreBlock] = {};
+    // One pole gains of the 15 Hz and bright filters
+    float hpl=0.0f, brl=0.0f;
 
-    float logsc(float param, const float min, const float max, const float rolloff = 19.0f);
+    void  updateCutOff();
+    float logsc(float param, const float min, const float max);
     float tptpc(float& state, float inp, float cutoff);
     float NR24(float sample, float g, float lpc);
     float modeLower(float value);
     float modeRise(float value);
+    float process(float x, float g, float lpc);
+    float preFilter(float x);
+    void  preFilter(const float* in, float* out, uint32_t frames);
+    void  updatePre();
+    template<int Mode, bool Fast> float processKernel(float x, float g, float lpc);
+    template<int Mode> float mixModes(float y1, float y2, float y3, float y4) const;
+    // Core without the atan damping while the states stay small
+    bool  linearFits(const float* x, uint32_t frames) const;
+    template<int Mode, bool Fast> uint32_t processLinear(const float* gMod, float* x, uint32_t frames);
+    template<int Mode, bool Fast> void  processBlock(const float* in, const float* gMod, float* out, uint32_t frames);
+    template<bool Fast> void processBlock(const float* in, const float* gMod, float* out, uint32_t frames);
 };
@@ -0,0 +1,176 @@
+/*
+ *  Robot Audio Plugins
+ *
+ *  Copyright (C) 2023      Martin Bångens
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "RobotHexedFilterLanes.hpp"
+#include "taskPool.hpp"
+
+/*
+ * Many independent mono streams through the Hexed filter in one call.
+ * Streams are dealt out to RobotHexedFilterLanes groups, a short block of
+ * each group is transposed into lanes, filtered kLanes streams at a time
+ * and transposed back. Stereo is two streams.
+ *
+ * Every stream keeps its own state, cutoff and resonance. Mode is shared
+ * by the whole farm like it is by the lanes. Output follows separate
+ * RobotHexedFilterDSP::process() calls to within the fastAtan error.
+ *
+ * With a RobotTaskPool every group is a task, groups share nothing so
+ * the output is the same on any number of threads.
+ */
+class RobotHexedFilterFarm
+{
+public:
+    typedef RobotHexedFilterLanes<ROBOT_HEXED_LANES> Lanes;
+    static const uint32_t kLanes = Lanes::kLanes;
+    // Frames transposed at a time, the two blocks stay in L1
+    static const uint32_t kBlockSize = 64;
+
+    explicit RobotHexedFilterFarm(double sampleRate = 44100.0, uint32_t streams = 0)
+        : sr(sampleRate)
+    {
+        setStreams(streams);
+    }
+
+    // Allocates, so the control thread only and never while process()
+    // runs. Every stream starts clear at cutoff 1 and resonance 0
+    void setStreams(uint32_t count)
+    {
+        streams = count;
+        groups.assign((count + kLanes-1) / kLanes, Lanes(sr));
+    }
+
+    // nullptr runs the groups one after the other on the calling thread
+    void setTaskPool(RobotTaskPool* value)
+    {
+        pool = value;
+    }
+
+    uint32_t getStreams() const
+    {
+        return streams;
+    }
+
+    void flush(double sampleRate)
+    {
+        sr = sampleRate;
+        for (Lanes& group : groups)
+            group.flush(sr);
+    }
+
+    void reset(uint32_t stream)
+    {
+        groups[stream / kLanes].reset(stream % kLanes);
+    }
+
+    // -------------------------------------------------------------------
+    // Parameters, 0-1 like RobotHexedFilterDSP
+
+    void setCutOff(uint32_t stream, float value)
+    {
+        groups[stream / kLanes].setCutOff(stream % kLanes, value);
+    }
+
+    void setCutOff(float value)
+    {
+        for (uint32_t s=0; s < streams; ++s)
+            setCutOff(s, value);
+    }
+
+    void setResonance(uint32_t stream, float value)
+    {
+        groups[stream / kLanes].setResonance(stream % kLanes, value);
+    }
+
+    void setResonance(float value)
+    {
+        for (uint32_t s=0; s < streams; ++s)
+            setResonance(s, value);
+    }
+
+    void setMode(float value)
+    {
+        for (Lanes& group : groups)
+            group.setMode(value);
+    }
+
+    // -------------------------------------------------------------------
+    // Process
+
+    /*
+     * in and out hold one buffer per stream, in place is fine
+     */
+    void process(const float* const* in, float* const* out, uint32_t frames)
+    {
+        taskIn     = in;
+        taskOut    = out;
+        taskFrames = frames;
+        robotExec(pool, &RobotHexedFilterFarm::processTask, this, (uint32_t)groups.size());
+    }
+
+private:
+    static void processTask(void* context, uint32_t index)
+    {
+        static_cast<RobotHexedFilterFarm*>(context)->processGroup(index);
+    }
+
+    void processGroup(uint32_t g)
+    {
+        alignas(16) float x[kBlockSize][kLanes];
+        alignas(16) float y[kBlockSize][kLanes];
+
+        Lanes& group = groups[g];
+        const uint32_t first = g * kLanes;
+        const uint32_t count = streams - first < kLanes ? streams - first : kLanes;
+
+        for (uint32_t i=0; i < taskFrames; i += kBlockSize)
+        {
+            const uint32_t n = taskFrames - i < kBlockSize ? taskFrames - i : kBlockSize;
+
+            // Streams to lanes, lanes past the last stream get silence
+            for (uint32_t l=0; l < kLanes; ++l)
+            {
+                if (l < count)
+                    for (uint32_t j=0; j < n; ++j)
+                        x[j][l] = taskIn[first+l][i+j];
+                else
+                    for (uint32_t j=0; j < n; ++j)
+                        x[j][l] = 0.0f;
+            }
+
+            for (uint32_t j=0; j < n; ++j)
+                group.tick(x[j], y[j]);
+
+            for (uint32_t l=0; l < count; ++l)
+                for (uint32_t j=0; j < n; ++j)
+                    taskOut[first+l][i+j] = y[j][l];
+        }
+    }
+
+    double sr;
+    uint32_t streams = 0;
+    std::vector<Lanes> groups;
+
+    // The call the tasks work on
+    RobotTaskPool*      pool = nullptr;
+    const float* const* taskIn  = nullptr;
+    float* const*       taskOut = nullptr;
+    uint32_t            taskFrames = 0;
+};
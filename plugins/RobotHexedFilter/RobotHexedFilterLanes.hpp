@@ -0,0 +1,213 @@
+/*
+ *  Robot Audio Plugins
+ *
+ *  Copyright (C) 2023      Martin Bångens
+ *  Copyright (c) 2013-2014 Pascal Gauthier
+ *  Copyright (c) 2013-2014 Filatov Vadim
+ *
+ *  Filter taken from the Obxd project :
+ *    https://github.com/asb2m10/dexed
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include "RobotHexedFilterDSP.hpp"
+#include "fastmath.hpp"
+#include "curves.hpp"
+
+/*
+ * Same filter as RobotHexedFilterDSP but with N independent states kept
+ * side by side (SoA), every loop goes over the lanes so one sample of all
+ * lanes is a handful of vector instructions.
+ * Coefficients that only change with parameters are precomputed per lane,
+ * so there is no division in the sample loop besides fastAtan.
+ */
+#if defined(__AVX512F__)
+#define ROBOT_HEXED_LANES 16
+#elif defined(__AVX__)
+#define ROBOT_HEXED_LANES 8
+#else
+#define ROBOT_HEXED_LANES 4
+#endif
+
+template<uint32_t N>
+class RobotHexedFilterLanes
+{
+public:
+    static const uint32_t kLanes = N;
+
+    // Nothing set up, flush() before the first tick()
+    RobotHexedFilterLanes() {}
+
+    explicit RobotHexedFilterLanes(double sampleRate)
+    {
+        flush(sampleRate);
+    }
+
+    void flush(double srate)
+    {
+        const RobotHexedRate rate(srate);
+
+        sr        = (float)srate;
+        srateInv  = rate.srateInv;
+        rcor24    = rate.rcor24;
+        rcor24Inv = rate.rcor24Inv;
+        bright    = rate.bright;
+        dc_r      = rate.dc_r;
+        const float c15 = (15 * srateInv)* PI_F;
+        lpc15 = c15 / (1 + c15);
+
+        for (uint32_t l=0; l < N; ++l)
+        {
+            reset(l);
+            rReso[l] = 0.0f;
+            R24[l]   = 0.0f;
+            setCutOffHz(l, 19000.0f);
+        }
+        setMode(4.0f);
+    }
+
+    // Clear the filter state of one lane, coefficients are kept
+    inline void reset(uint32_t l)
+    {
+        s1[l] = s2[l] = s3[l] = s4[l] = 0.0f;
+        c[l]  = d[l]  = dc_tmp[l] = 0.0f;
+    }
+
+    // Same as RobotHexedFilterDSP::setCutOff() for a 0-1 parameter
+    void setCutOff(uint32_t l, float value)
+    {
+        setCutOffHz(l, robotLogsc(value, 60, 19000));
+    }
+
+    void setCutOffHz(uint32_t l, float hz)
+    {
+        const float gl  = (float)tan(hz * srateInv * PI_F);
+        const float brl = bright - ((bright-1)*(1.0-((hz-60)*0.000000016)));
+        lpc[l]   = gl / (1 + gl);
+        lpcBr[l] = brl / (1 + brl);
+        ml[l]    = 1 / (1 + gl);
+        G4[l]    = lpc[l]*lpc[l]*lpc[l]*lpc[l];
+        updateFeedback(l);
+    }
+
+    void setResonance(uint32_t l, float value)
+    {
+        rReso[l]   = (0.991-robotLogsc(1-value, 0, 0.991));
+        R24[l]     = 3.7 * rReso[l];
+        outGain[l] = ( 1 + R24[l] * 0.45 ) * (1-(mm_balancer*rReso[l]*0.96422));
+        updateFeedback(l);
+    }
+
+    // Mode is shared by all lanes, same crossfade as RobotHexedFilterDSP::setMode()
+    void setMode(float value)
+    {
+        if(value<1.0f) value = 1.0f;
+        if(value>4.0f) value = 4.0f;
+        int   offset = (int)value;
+        float remain = value-offset;
+        float m[5] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+        if (remain==0)
+            m[offset] = 1.0f;
+        else
+        {
+            m[offset]   = 1.0f-remain;
+            m[offset+1] = remain;
+        }
+        mmt_y1 = m[1]; mmt_y2 = m[2]; mmt_y3 = m[3]; mmt_y4 = m[4];
+    }
+
+    /*
+     * One sample for every lane, in and out hold N values
+     */
+    inline void tick(const float* in, float* out)
+    {
+        for (uint32_t l=0; l < N; ++l)
+        {
+            // Simple DC filter
+            float x = in[l];
+            float xo = x - dc_tmp[l] + dc_r * dc_tmp[l];
+            dc_tmp[l] = x;
+            // Remove a bit under 15
+            float v = (xo - c[l]) * lpc15;
+            float y = v + c[l];
+            c[l]    = y + v;
+            xo      = xo - 0.45f*y;
+            // Add bright value..
+            v    = (xo - d[l]) * lpcBr[l];
+            xo   = v + d[l];
+            d[l] = xo + v;
+
+            // NR24
+            const float lp = lpc[l];
+            const float S  = (lp*(lp*(lp*s1[l]+s2[l])+s3[l])+s4[l])*ml[l];
+            const float y0 = (xo - R24[l]*S) * fbDen[l] + 1e-8f;
+
+            // Cascade with damping on the first state
+            v = (y0 - s1[l]) * lp;
+            const float y1 = v + s1[l];
+            s1[l] = fastAtan((y1 + v)*rcor24)*rcor24Inv;
+            v = (y1 - s2[l]) * lp;
+            const float y2 = v + s2[l];
+            s2[l] = y2 + v;
+            v = (y2 - s3[l]) * lp;
+            const float y3 = v + s3[l];
+            s3[l] = y3 + v;
+            v = (y3 - s4[l]) * lp;
+            const float y4 = v + s4[l];
+            s4[l] = y4 + v;
+
+            out[l] = (mmt_y1*y1 + mmt_y2*y2 + mmt_y3*y3 + mmt_y4*y4) * outGain[l];
+        }
+    }
+
+private:
+    inline void updateFeedback(uint32_t l)
+    {
+        fbDen[l] = 1 / (1 + R24[l]*G4[l]);
+    }
+
+    // -------------------------------------------------------------------
+    // Per lane state
+    alignas(16) float s1[N] = {};
+    alignas(16) float s2[N] = {};
+    alignas(16) float s3[N] = {};
+    alignas(16) float s4[N] = {};
+    alignas(16) float c[N] = {};
+    alignas(16) float d[N] = {};
+    alignas(16) float dc_tmp[N] = {};
+
+    // -------------------------------------------------------------------
+    // Per lane coefficients
+    alignas(16) float lpc[N] = {};
+    alignas(16) float lpcBr[N] = {};
+    alignas(16) float ml[N] = {};
+    alignas(16) float G4[N] = {};
+    alignas(16) float R24[N] = {};
+    alignas(16) float rReso[N] = {};
+    alignas(16) float fbDen[N] = {};
+    alignas(16) float outGain[N] = {};
+
+    // -------------------------------------------------------------------
+    // Shared
+    float sr = 0.0f, srateInv = 0.0f;
+    float rcor24 = 0.0f, rcor24Inv = 0.0f;
+    float bright = 0.0f;
+    float dc_r = 0.0f;
+    float lpc15 = 0.0f;
+    float mm_balancer = 0.7578f;
+    float mmt_y1 = 0.0f, mmt_y2 = 0.0f, mmt_y3 = 0.0f, mmt_y4 = 1.0f;
+};
@@ -20,18 +20,29 @@
  */
 
 #include "RobotHexedFilterPlugin.hpp"
+#include <cstring>
+#include "curves.hpp"
 
 START_NAMESPACE_DISTRHO
 
+// Two filters per instance, keep them at four cache lines each so a few
+// hundred instances still fit in L2. The second two hold the fused pre
+// filter, only read once per block.
+static_assert(sizeof(RobotHexedFilterDSP) <= 256, "RobotHexedFilterDSP grew past four cache lines");
+
 // --------------------------------------------------------------------------------------------
 
 RobotHexedFilterPlugin::RobotHexedFilterPlugin()
-    : Plugin(paramCount, 1, 0), // parameters, program, states
-      left(getSampleRate()),
-      right(getSampleRate())
+    : Plugin(paramCount, 1, 0) // parameters, program, states
 {
-    // set default values
+    // set default values, the dsp is set up by the first activate() so a
+    // host scanning plugins pays for none of it
     loadProgram(0);
+
+    // Taken now, parameters the host sets before activate() come after it
+    float values[paramCount];
+    if (program.take(values))
+        setProgramValues(values);
 }
 
 // --------------------------------------------------------------------------------------------
@@ -39,6 +50,16 @@ RobotHexedFilterPlugin::RobotHexedFilterPlugin()
 
 void RobotHexedFilterPlugin::initAudioPort(bool input, uint32_t index, AudioPort& port)
 {
+    if (input && index == 2)
+    {
+        port.hints   = kAudioPortIsCV | kCVPortHasBipolarRange;
+        port.groupId = kPortGroupNone;
+        Plugin::initAudioPort(input, index, port);
+        port.name    = "CutOff CV";
+        port.symbol  = "freq_cv";
+        return;
+    }
+
     port.groupId = kPortGroupStereo;
 
     Plugin::initAudioPort(input, index, port);
@@ -92,6 +113,63 @@ void RobotHexedFilterPlugin::initParameter(uint32_t index, Parameter& parameter)
         parameter.ranges.max = 100.0f;
         break;
 
+    case paramCutOffMod:
+        parameter.hints      = kParameterIsAutomatable;
+        parameter.name       = "CutOffMod";
+        parameter.shortName  = "CutOffMod";
+        parameter.symbol     = "freqmod";
+        parameter.unit       = "%";
+        parameter.ranges.def = 0.0f;
+        parameter.ranges.min = 0.0f;
+        parameter.ranges.max = 100.0f;
+        break;
+
+    case paramRecoveries:
+        parameter.hints      = kParameterIsOutput | kParameterIsInteger;
+        parameter.name       = "Recoveries";
+        parameter.shortName  = "Recoveries";
+        parameter.symbol     = "recoveries";
+        parameter.unit       = "";
+        parameter.ranges.def = 0.0f;
+        parameter.ranges.min = 0.0f;
+        parameter.ranges.max = 1000000.0f;
+        break;
+
+    case paramQuality:
+        // CPU against accuracy, not something to automate
+        parameter.hints      = kParameterIsInteger;
+        parameter.name       = "Quality";
+        parameter.shortName  = "Quality";
+        parameter.symbol     = "quality";
+        parameter.unit       = "";
+        parameter.ranges.def = kQualityNormal;
+        parameter.ranges.min = kQualityEco;
+        parameter.ranges.max = kQualityHigh;
+        parameter.enumValues.count          = kQualityCount;
+        parameter.enumValues.restrictedMode = true;
+        {
+            ParameterEnumerationValue* const values = new ParameterEnumerationValue[kQualityCount];
+            for (int q=0; q < kQualityCount; ++q)
+            {
+                values[q].value = q;
+                values[q].label = robotQualityNames[q];
+            }
+            parameter.enumValues.values = values;
+        }
+        break;
+
+    case paramAdaptiveRate:
+        // Lower internal rate for low cutoffs, CPU against a bit of latency
+        parameter.hints      = kParameterIsBoolean | kParameterIsInteger;
+        parameter.name       = "AdaptiveRate";
+        parameter.shortName  = "AdaptiveRate";
+        parameter.symbol     = "adaptive_rate";
+        parameter.unit       = "";
+        parameter.ranges.def = 0.0f;
+        parameter.ranges.min = 0.0f;
+        parameter.ranges.max = 1.0f;
+        break;
+
     }
 }
 
@@ -124,6 +202,18 @@ float RobotHexedFilterPlugin::getParameterValue(uint32_t index) const
     case paramWet:
         return fWet;
 
+    case paramCutOffMod:
+        return fCutOffMod;
+
+    case paramRecoveries:
+        return (float)health.getRecoveries();
+
+    case paramQuality:
+        return fQuality;
+
+    case paramAdaptiveRate:
+        return fAdaptiveRate;
+
     default:
         return 0.0f;
     }
@@ -134,6 +224,13 @@ void RobotHexedFilterPlugin::setParameterValue(uint32_t index, float value)
     if (getSampleRate() <= 0.0)
         return;
 
+    ROBOT_TRACE_EVENT(kParameter, index, value);
+
+    // A program loaded before this value came first, so it lands first
+    float values[paramCount];
+    if (program.take(values))
+        setProgramValues(values);
+
     switch (index)
     {
     case paramCutOff:
@@ -148,31 +245,59 @@ void RobotHexedFilterPlugin::setParameterValue(uint32_t index, float value)
 
     case paramMode:
         fMode = value;
+        mode = fMode;
         break;
 
     case paramWet:
         fWet = value;
         wet = fWet*0.01;
         break;
+
+    case paramCutOffMod:
+        fCutOffMod = value;
+        cutoffMod = fCutOffMod*0.01;
+        break;
+
+    case paramQuality:
+        // Picked up by run() at the next micro-block
+        fQuality = value;
+        break;
+
+    case paramAdaptiveRate:
+        // Same, the factor follows at the next micro-block
+        fAdaptiveRate = value;
+        break;
     }
 }
 
+/*
+ * Called off the audio thread while run() may be busy, so only the values
+ * the host reads back change here. run() takes the rest at a micro-block.
+ */
 void RobotHexedFilterPlugin::loadProgram(uint32_t index)
 {
+    float values[paramCount];
+    for (uint32_t p=0; p < paramCount; ++p)
+        values[p] = getParameterValue(p);
+
     switch (index)
     {
     case 0:
         // Default
-        fCutOff    = 100.0f;
-        cutoff     = 1.0f;
-        fResonance = 0.0f;
-        resonance  = 0.0f;
-        fMode      = 4;
-        fWet       = 0.0f;
-        wet        = 0.0f;
-        activate();
+        values[paramCutOff]    = 100.0f;
+        values[paramResonance] = 0.0f;
+        values[paramMode]      = 4;
+        values[paramWet]       = 0.0f;
+        values[paramCutOffMod] = 0.0f;
         break;
     }
+
+    fCutOff    = values[paramCutOff];
+    fResonance = values[paramResonance];
+    fMode      = values[paramMode];
+    fWet       = values[paramWet];
+    fCutOffMod = values[paramCutOffMod];
+    program.publish(values);
 }
 
 // -----------------------------------------------------------------------
@@ -180,61 +305,470 @@ void RobotHexedFilterPlugin::loadProgram(uint32_t index)
 
 void RobotHexedFilterPlugin::activate()
 {
-    left.flush(getSampleRate());
+    const double sr = getSampleRate();
+
+    // Not running, a program loaded since is simply set
+    float values[paramCount];
+    if (program.take(values))
+        setProgramValues(values);
+
+    // Everything timed by the rate, the tables and the scratch only when it
+    // changed since the last activate(), else the filters just start clean
+    if (sr != activeRate)
+    {
+        activeRate = sr;
+        health.setSampleRate(sr);
+        sWet.setSampleRate(sr);
+        sCutOff.setSampleRate(sr);
+        sResonance.setSampleRate(sr);
+        sMode.setSampleRate(sr);
+        CutOffLPF.setSampleRate(sr);
+        CutOffLI.setSampleRate(sr);
+        ResonanceLPF.setSampleRate(sr);
+        ResonanceLI.setSampleRate(sr);
+        ModeLI.setSampleRate(sr);
+        WetLI.setSampleRate(sr);
+
+        left.flush(sr);
+        right.flush(sr);
+
+        fadeFrames = (uint32_t)(sr*0.001*kFadeMs);
+        if (fadeFrames == 0)
+            fadeFrames = 1;
+
+        // run() works on one micro-block at a time, three buffers for it, two
+        // more while a program fades and two for a decimated filter
+        scratch.allocate(7*RobotScratch::bytes<float>(kBlockSize));
+    }
+    else
+    {
+        left.reset();
+        right.reset();
+        health.reset();
+    }
+    smoothCutOff = cutoff;
+
     left.setCutOff(cutoff);
     left.setResonance(resonance);
     wetLeft.setWet(wet);
-    left.setMode(fMode);
+    left.setMode(mode);
 
-    right.flush(getSampleRate());
     right.setCutOff(cutoff);
     right.setResonance(resonance);
     wetRight.setWet(wet);
-    right.setMode(fMode);
+    right.setMode(mode);
+
+    // Host rate until run() picks a factor
+    rateShift = 0;
+    fadeShift = 0;
+    chainLeft.reset(0);
+    chainRight.reset(0);
+
+    // Same tables as the filters, so a fade never frees them in run()
+    fadeLeft  = left;
+    fadeRight = right;
+    fadeChainLeft  = chainLeft;
+    fadeChainRight = chainRight;
+    fade       = 0;
+
+    phase  = 0;
+    path   = kPathBlock;
+    gNow   = left.getG();
+    gRatio = 1.0f;
+    setQuality(robotQuality(fQuality));
 }
 
 void RobotHexedFilterPlugin::deactivate()
 {
-    //TODO maybe there could be someting done here to minimized the work on activate()
+    // Nothing to let go of, activate() at the same rate picks the tables
+    // and the scratch up again
 }
 
 
 void RobotHexedFilterPlugin::run(const float** inputs, float** outputs, uint32_t frames)
 {
-    for (uint32_t i=0; i < frames; ++i)
+    scratch.reset();
+    float* const bufLeft  = scratch.take<float>(kBlockSize);
+    float* const bufRight = scratch.take<float>(kBlockSize);
+    float* const gMod     = scratch.take<float>(kBlockSize);
+    const float* cv = inputs[2];
+    float values[paramCount];
+    // Coefficient recomputations, only reported to the trace
+    uint32_t updates = 0;
+
+    ROBOT_TRACE_EVENT(kBlockBegin, 0, frames);
+
+    for (uint32_t i=0; i < frames;)
     {
-        float c = sCutOff.processChangeTrigger(cutoff , cutoff);
-        if(0.0f!=c)
+        // The path is picked at the start of every micro-block and kept to
+        // its end, so the output does not depend on how the host cuts its
+        // buffers
+        if (phase == 0)
         {
-            float fc = CutOffLPF.process(CutOffLI.process(c));
-            left.setCutOff(fc);
-            right.setCutOff(fc);
-
+            if (program.take(values))
+                startProgram(values);
+
+            const int q = robotQuality(fQuality);
+            if (q != quality)
+                setQuality(q);
+
+            const int last = path;
+            if (wet == 0.0f && sWet.isIdle(wet))
+                path = kPathBypass;
+            else if (!sResonance.isIdle(resonance) || !sMode.isIdle(mode))
+                path = kPathSample;
+            else if (!sCutOff.isIdle(cutoff))
+                path = kPathCutOff;
+            else
+                path = kPathBlock;
+
+            // Waking up, start from a clean state while wet ramps in from
+            // 0 so the old state does not click
+            if (last == kPathBypass && path != kPathBypass)
+            {
+                left.reset();
+                right.reset();
+                chainLeft.reset(rateShift);
+                chainRight.reset(rateShift);
+                ROBOT_TRACE_EVENT(kWake, 0, 2);
+            }
+            else if (last != kPathBypass && path == kPathBypass)
+            {
+                fade = 0;
+                ROBOT_TRACE_EVENT(kSleep, 0, 0);
+            }
+
+            // A lower rate waits for a fade to end, the host rate for a
+            // ramp or the CV does not
+            const int shift = getRateShift();
+            if (shift < rateShift || (shift > rateShift && fade == 0))
+                setRateShift(shift);
         }
-        float r = sResonance.processChangeTrigger(resonance, resonance);
-        if(0.0f!=r)
+        // CV turned on inside a decimated block is heard from the next one
+        const bool mod = cutoffMod != 0.0f && rateShift == 0;
+        const uint32_t n = (frames-i < kBlockSize-phase) ? frames-i : kBlockSize-phase;
+
+        if (path == kPathBypass)
         {
-            float fr = ResonanceLPF.process(ResonanceLI.process(r));
-            left.setResonance(fr);
-            right.setResonance(fr);
+            // Wet is 0 and settled, the output is the input
+            if (outputs[0] != inputs[0])
+                std::memcpy(outputs[0]+i, inputs[0]+i, sizeof(float)*n);
+            if (outputs[1] != inputs[1])
+                std::memcpy(outputs[1]+i, inputs[1]+i, sizeof(float)*n);
+            i += n;
+            phase = (phase+n) & (kBlockSize-1);
+            continue;
         }
-        float m = sMode.processChangeTrigger(fMode, fMode);
-        if(0.0f!=m)
+
+        switch (path)
         {
-            float fm = ModeLI.process(fMode);
-            left.setMode(fm);
-            right.setMode(fm);
+        case kPathBlock:
+            // Coefficients are settled, let the filters run the whole
+            // block with the kernel for the current mode
+            if (mod)
+            {
+                // Cutoff for every sample of the block in one vector pass
+                for (uint32_t j=0; j < n; ++j)
+                    bufLeft[j] = smoothCutOff + cutoffMod*cv[i+j];
+                cutOffToG(bufLeft, gMod, n);
+                left.process(inputs[0]+i, gMod, bufLeft, n);
+                right.process(inputs[1]+i, gMod, bufRight, n);
+            }
+            else
+            {
+                processChannel(left, chainLeft, inputs[0]+i, nullptr, bufLeft, n);
+                processChannel(right, chainRight, inputs[1]+i, nullptr, bufRight, n);
+            }
+            break;
+
+        case kPathCutOff:
+            // Only the cutoff ramps, step the smoothing every sample but
+            // compute exact coefficients on the controlSize grid. g gets
+            // to them geometrically by the next grid point, cutoff is
+            // exponential in the parameter so log g is close to a line.
+            for (uint32_t j=0; j < n; ++j)
+            {
+                if(sCutOff.processChangeTrigger(cutoff))
+                    smoothCutOff = CutOffLPF.process(CutOffLI.process(cutoff));
+
+                const uint32_t pos = (phase+j) & (controlSize-1);
+                if (pos == 0)
+                {
+                    left.setCutOff(smoothCutOff);
+                    right.setCutOff(smoothCutOff);
+                    gRatio = (controlSize > 1 && left.getG() != gNow)
+                           ? powf(left.getG()/gNow, 1.0f/controlSize) : 1.0f;
+                    ++updates;
+                }
+                gNow = (pos == controlSize-1) ? left.getG() : gNow*gRatio;
+                gMod[j]    = gNow;
+                bufLeft[j] = smoothCutOff + cutoffMod*cv[i+j];
+            }
+            if (mod)
+                cutOffToG(bufLeft, gMod, n);
+            processChannel(left, chainLeft, inputs[0]+i, gMod, bufLeft, n);
+            processChannel(right, chainRight, inputs[1]+i, gMod, bufRight, n);
+            break;
+
+        case kPathSample:
+            for (uint32_t j=0; j < n; ++j)
+            {
+                if(sCutOff.processChangeTrigger(cutoff))
+                {
+                    float fc = CutOffLPF.process(CutOffLI.process(cutoff));
+                    left.setCutOff(fc);
+                    right.setCutOff(fc);
+                    smoothCutOff = fc;
+                    ++updates;
+                }
+                if(sResonance.processChangeTrigger(resonance))
+                {
+                    float fr = ResonanceLPF.process(ResonanceLI.process(resonance));
+                    left.setResonance(fr);
+                    right.setResonance(fr);
+                    ++updates;
+                }
+                if(sMode.processChangeTrigger(mode))
+                {
+                    float fm = ModeLI.process(mode);
+                    left.setMode(fm);
+                    right.setMode(fm);
+                    ++updates;
+                }
+                if (mod)
+                {
+                    const float gm = cutOffToG(smoothCutOff + cutoffMod*cv[i+j]);
+                    bufLeft[j]  = left.process(inputs[0][i+j], gm);
+                    bufRight[j] = right.process(inputs[1][i+j], gm);
+                }
+                else
+                {
+                    bufLeft[j]  = left.process(inputs[0][i+j]);
+                    bufRight[j] = right.process(inputs[1][i+j]);
+                }
+            }
+            gNow = left.getG();
+            break;
         }
-        float w = sWet.processChangeTrigger(wet, wet);
-        if(0.0f!=w)
-        {
-            float fw = WetLI.process(wet);
-            wetLeft.setWet(fw);
-            wetRight.setWet(fw);
 
+        if (fade > 0)
+            processFade(inputs, bufLeft, bufRight, i, n);
+
+        for (uint32_t j=0; j < n; ++j, ++i)
+        {
+            processWet();
+            outputs[0][i] = wetLeft.process(inputs[0][i], bufLeft[j]);
+            outputs[1][i] = wetRight.process(inputs[1][i], bufRight[j]);
         }
-        outputs[0][i] = wetLeft.process(inputs[0][i], left.process(inputs[0][i]));
-        outputs[1][i] = wetRight.process(inputs[1][i], right.process(inputs[1][i]));
+        phase = (phase+n) & (kBlockSize-1);
+    }
+
+    // A handful of state floats per block, well below the filter cost. The
+    // fading filters are checked too, a NaN they pick up during a fade
+    // stays in them and they are reset with the others
+    const bool stateHealthy = left.isHealthy(RobotHealth::kLimit) && right.isHealthy(RobotHealth::kLimit)
+                           && fadeLeft.isHealthy(RobotHealth::kLimit) && fadeRight.isHealthy(RobotHealth::kLimit);
+    if (!health.process(outputs, 2, frames, stateHealthy))
+    {
+        left.reset();
+        right.reset();
+        chainLeft.reset(rateShift);
+        chainRight.reset(rateShift);
+        fadeLeft.reset();
+        fadeRight.reset();
+        fadeChainLeft.reset(fadeShift);
+        fadeChainRight.reset(fadeShift);
+        fade = 0;
+        ROBOT_TRACE_EVENT(kRecover, 0, health.getRecoveries());
+    }
+
+    ROBOT_TRACE_EVENT(kCoefficients, 0, updates);
+    ROBOT_TRACE_EVENT(kBlockEnd, 0, frames);
+}
+
+/*
+ * Eco runs the float kernel with a coarse atan and exact coefficients once a
+ * block, High exact coefficients every sample and tan() for the CV. The
+ * filter state is the same in every tier.
+ */
+void RobotHexedFilterPlugin::setQuality(int value)
+{
+    quality = value;
+    left.setFast(quality == kQualityEco);
+    right.setFast(quality == kQualityEco);
+    controlSize = quality == kQualityEco  ? kBlockSize
+                : quality == kQualityHigh ? 1 : kControlSize;
+}
+
+float RobotHexedFilterPlugin::cutOffToG(float value) const
+{
+    return quality == kQualityHigh ? left.cutOffToGExact(value) : left.cutOffToG(value);
+}
+
+void RobotHexedFilterPlugin::cutOffToG(const float* value, float* gOut, uint32_t frames) const
+{
+    if (quality == kQualityHigh)
+        left.cutOffToGExact(value, gOut, frames);
+    else
+        left.cutOffToG(value, gOut, frames);
+}
+
+void RobotHexedFilterPlugin::setProgramValues(const float* values)
+{
+    cutoff    = values[paramCutOff]*0.01;
+    resonance = values[paramResonance]*0.01;
+    mode      = values[paramMode];
+    wet       = values[paramWet]*0.01;
+    cutoffMod = values[paramCutOffMod]*0.01;
+}
+
+/*
+ * A program lands at a micro-block. The filters as they are keep running
+ * with their coefficients and fade out, left and right start clean like
+ * activate() would leave them and fade in while the parameters ramp to
+ * the program. Copying a filter does not allocate, the tables are shared.
+ */
+void RobotHexedFilterPlugin::startProgram(const float* values)
+{
+    if (path != kPathBypass)
+    {
+        fadeLeft  = left;
+        fadeRight = right;
+        fadeChainLeft  = chainLeft;
+        fadeChainRight = chainRight;
+        fadeShift = rateShift;
+        fade      = fadeFrames;
+        left.reset();
+        right.reset();
+    }
+    setProgramValues(values);
+    ROBOT_TRACE_EVENT(kProgram, 0, fade);
+}
+
+void RobotHexedFilterPlugin::processFade(const float** inputs, float* bufLeft, float* bufRight, uint32_t i, uint32_t n)
+{
+    const RobotScratch::Scope scope(scratch);
+    float* const oldLeft  = scratch.take<float>(kBlockSize);
+    float* const oldRight = scratch.take<float>(kBlockSize);
+    processChannel(fadeLeft, fadeChainLeft, inputs[0]+i, nullptr, oldLeft, n);
+    processChannel(fadeRight, fadeChainRight, inputs[1]+i, nullptr, oldRight, n);
+
+    const float step = 1.0f/fadeFrames;
+    for (uint32_t j=0; j < n; ++j)
+    {
+        const float t = fade > 0 ? 1.0f - fade*step : 1.0f;
+        bufLeft[j]  = oldLeft[j]  + (bufLeft[j]  - oldLeft[j])*t;
+        bufRight[j] = oldRight[j] + (bufRight[j] - oldRight[j])*t;
+        if (fade > 0)
+            --fade;
+    }
+}
+
+/*
+ * Decimation for the adaptive rate, in stages of 2. The filter slope has
+ * to be 48 dB down at the lower Nyquist, that is 2 octaves above the
+ * cutoff with 4 poles and 8 with 1. Only settled blocks and cutoff ramps
+ * without CV run decimated. A stage is only added with the cutoff well
+ * under its limit, so a cutoff sitting at it does not switch back and forth.
+ */
+int RobotHexedFilterPlugin::getRateShift() const
+{
+    if (fAdaptiveRate < 0.5f || cutoffMod != 0.0f || (path != kPathBlock && path != kPathCutOff))
+        return 0;
+
+    // Crossfaded modes are as steep as the lower pole count
+    const float poles = mode < 1.0f ? 1.0f : floorf(mode);
+    // A ramp goes from smoothCutOff to cutoff, the higher one counts
+    const float top   = robotLogsc(fmaxf(smoothCutOff, cutoff), 60, 19000) * exp2f(8.0f/poles);
+
+    int shift = 0;
+    while (shift < RobotRateChain::kMaxStages)
+    {
+        // Nyquist one stage further down
+        const double nyquist = getSampleRate() / (4 << shift);
+        const double margin  = shift < rateShift ? 1.0 : 0.7;
+        if (top > nyquist*margin)
+            break;
+        ++shift;
+    }
+    return shift;
+}
+
+/*
+ * A new factor lands at a micro-block. Like a program change the filters
+ * as they are fade out with their chains and factor, left and right keep
+ * their state with coefficients for the new rate and fade in. Asleep there
+ * is nothing to fade, the wake up starts from a clean state.
+ */
+void RobotHexedFilterPlugin::setRateShift(int shift)
+{
+    if (path != kPathBypass)
+    {
+        fadeLeft  = left;
+        fadeRight = right;
+        fadeChainLeft  = chainLeft;
+        fadeChainRight = chainRight;
+        fadeShift = rateShift;
+        fade      = fadeFrames;
+    }
+
+    rateShift = shift;
+    const double rate = getSampleRate() / (1 << shift);
+    left.setRate(rate);
+    right.setRate(rate);
+    chainLeft.setStages(shift);
+    chainRight.setStages(shift);
+    // The cutoff ramp starts over in g of the new rate
+    gNow   = left.getG();
+    gRatio = 1.0f;
+    ROBOT_TRACE_EVENT(kRate, 0, 1 << shift);
+}
+
+/*
+ * One filter over n host samples, straight at the host rate or through
+ * its chain. gMod is g per host sample in the filter's rate, decimated it
+ * takes the one where each lower rate sample completes.
+ */
+void RobotHexedFilterPlugin::processChannel(RobotHexedFilterDSP& filter, RobotRateChain& chain,
+                                            const float* in, const float* gMod, float* out, uint32_t n)
+{
+    const int stages = chain.getStages();
+    if (stages == 0)
+    {
+        if (gMod != nullptr)
+            filter.process(in, gMod, out, n);
+        else
+            filter.process(in, out, n);
+        return;
+    }
+
+    const RobotScratch::Scope scope(scratch);
+    float* const low  = scratch.take<float>(kBlockSize);
+    float* const gLow = scratch.take<float>(kBlockSize);
+    const uint32_t m = chain.down(in, low, n);
+    if (gMod != nullptr)
+    {
+        // The chain groups on the micro-block grid, it only changes at phase 0
+        const uint32_t last = (1u << stages) - 1;
+        uint32_t k = 0;
+        for (uint32_t j=0; j < n; ++j)
+            if (((phase+j) & last) == last)
+                gLow[k++] = gMod[j];
+        filter.process(low, gLow, low, m);
+    }
+    else
+        filter.process(low, low, m);
+    chain.up(low, m);
+    chain.pop(out, n);
+}
+
+inline void RobotHexedFilterPlugin::processWet()
+{
+    if(sWet.processChangeTrigger(wet))
+    {
+        float fw = WetLI.process(wet);
+        wetLeft.setWet(fw);
+        wetRight.setWet(fw);
     }
 }
 
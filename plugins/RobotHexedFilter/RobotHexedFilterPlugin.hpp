@@ -27,6 +27,13 @@
 #include "wet.hpp"
 #include "smooth.hpp"
 #include "samplePlayer.hpp"
+#include "alignedNew.hpp"
+#include "trace.hpp"
+#include "health.hpp"
+#include "quality.hpp"
+#include "snapshot.hpp"
+#include "scratch.hpp"
+#include "decimate.hpp"
 
 START_NAMESPACE_DISTRHO
 
@@ -40,13 +47,37 @@ class RobotHexedFilterPlugin : public Plugin
         paramResonance,
         paramMode,
         paramWet,
+        paramCutOffMod,
+        paramRecoveries,
+        paramQuality,
+        paramAdaptiveRate,
         paramCount
     };
 
+    // Fixed micro-block, run() cuts the host buffer on this grid and the
+    // grid carries over between calls
+    static const uint32_t kBlockSize = 32;
+    // Samples between exact cutoff coefficients while the cutoff ramps,
+    // a divisor of kBlockSize. Normal quality, Eco takes a whole block
+    // and High computes them every sample
+    static const uint32_t kControlSize = 16;
+    // Crossfade after a program change
+    static constexpr float kFadeMs = 10.0f;
+
+    // How a micro-block is processed
+    enum Paths
+    {
+        kPathBlock = 0,  // nothing ramps, whole block kernels
+        kPathCutOff,     // cutoff ramps, control rate coefficients
+        kPathSample,     // resonance or mode ramps, per sample
+        kPathBypass      // wet is 0, input is copied and the filters sleep
+    };
 
 public:
     RobotHexedFilterPlugin();
 
+    ROBOT_DECLARE_ALIGNED_NEW(RobotHexedFilterPlugin)
+
 protected:
     // -------------------------------------------------------------------
     // Information
@@ -110,36 +141,104 @@ protected:
     // -------------------------------------------------------------------
 
 private:
+    void processWet();
+    void setQuality(int value);
+    // Parameters of a program for the filters
+    void setProgramValues(const float* values);
+    void startProgram(const float* values);
+    void processFade(const float** inputs, float* bufLeft, float* bufRight, uint32_t i, uint32_t n);
+    // Adaptive rate, decimation for the cutoff and the switch to it
+    int  getRateShift() const;
+    void setRateShift(int shift);
+    void processChannel(RobotHexedFilterDSP& filter, RobotRateChain& chain,
+                        const float* in, const float* gMod, float* out, uint32_t n);
+    // Cutoff CV to g, exact in High and from the table otherwise
+    float cutOffToG(float value) const;
+    void  cutOffToG(const float* value, float* gOut, uint32_t frames) const;
+
+    // -------------------------------------------------------------------
+    // Dsp
+    //
+    // Laid out by how often run() touches it. A settled instance reads the
+    // first line of each filter and the wet line every sample, the ramp
+    // triggers once per block and the smoothers only while ramping. Rates
+    // and times come from activate(), they are built without one here.
+    RobotHexedFilterDSP left;
+    RobotHexedFilterDSP right;
+
+    // Every sample
+    alignas(64) RobotBufferPlayer sWet = RobotBufferPlayer(0.0, 24, 0.0f);
+    RobotWet wetLeft;
+    RobotWet wetRight;
+    float wet       = 0.0;
+
+    // Once per block
+    RobotBufferPlayer sCutOff = RobotBufferPlayer(0.0, 45, 1.0f);
+    RobotBufferPlayer sResonance = RobotBufferPlayer(0.0, 45, 0.0f);
+    RobotBufferPlayer sMode = RobotBufferPlayer(0.0, 24, 4.0f);
+    float cutoff    = 1.0;
+    float resonance = 0.0;
+    float mode      = 4;
+    float cutoffMod = 0.0;
+    // Cutoff the smoothing last handed to the filters, CV is added to it
+    float smoothCutOff = 1.0;
+    // Position in the current micro-block and how it is processed
+    uint32_t phase = 0;
+    int      path  = kPathBlock;
+    // g the cutoff ramp runs with, moves to the filters g over controlSize
+    float    gNow  = 1.0f;
+    float    gRatio = 1.0f;
+    // Tier in use, changes at the start of a micro-block
+    int      quality = kQualityNormal;
+    uint32_t controlSize = kControlSize;
+
+    // Program values from loadProgram(), run() takes them at a micro-block
+    RobotSnapshot<paramCount> program;
+    // The filters from before the change fade out over fadeFrames while
+    // left and right fade in from a clean state
+    RobotHexedFilterDSP fadeLeft;
+    RobotHexedFilterDSP fadeRight;
+    uint32_t fade = 0;
+    uint32_t fadeFrames = 1;
+
+    // Adaptive rate, the filters run down by 1 << rateShift with the wet
+    // mix at the host rate. The fading filters keep the chains and the
+    // factor they had.
+    RobotRateChain chainLeft;
+    RobotRateChain chainRight;
+    RobotRateChain fadeChainLeft;
+    RobotRateChain fadeChainRight;
+    int rateShift = 0;
+    int fadeShift = 0;
+
+    // Block buffers for run(), sized in activate()
+    RobotScratch scratch;
+    // Rate of the last activate(), 0 before the first
+    double activeRate = 0.0;
+
     // -------------------------------------------------------------------
     // Parameters
 
-    LPFSmooth CutOffLPF    = LPFSmooth(21.32f,getSampleRate());
-    LISmooth  CutOffLI     = LISmooth(21.34f,getSampleRate());
-    LPFSmooth ResonanceLPF = LPFSmooth(21.32f,getSampleRate());
-    LISmooth  ResonanceLI  = LISmooth(21.34f,getSampleRate());
-    LISmooth  ModeLI       = LISmooth(21.34f,getSampleRate());
-    LISmooth  WetLI        = LISmooth(21.34f,getSampleRate());
+    LPFSmooth CutOffLPF    = LPFSmooth(21.32f, 0.0f);
+    LISmooth  CutOffLI     = LISmooth(21.34f, 0.0f);
+    LPFSmooth ResonanceLPF = LPFSmooth(21.32f, 0.0f);
+    LISmooth  ResonanceLI  = LISmooth(21.34f, 0.0f);
+    LISmooth  ModeLI       = LISmooth(21.34f, 0.0f);
+    LISmooth  WetLI        = LISmooth(21.34f, 0.0f);
 
     float fCutOff   = 100.0;
-    float cutoff    = fCutOff*0.01;
     float fResonance = 0.0;
-    float resonance = 0.0;
     float fMode     = 4;
     float fWet      = 0.0; 
-    float wet      = 0.0; 
+    float fCutOffMod = 0.0;
+    float fQuality   = kQualityNormal;
+    float fAdaptiveRate = 0.0f;
 
-    RobotBufferPlayer sCutOff = RobotBufferPlayer(getSampleRate(), 45, 1.0f);
-    RobotBufferPlayer sResonance = RobotBufferPlayer(getSampleRate(), 45, 0.0f);
-    RobotBufferPlayer sMode = RobotBufferPlayer(getSampleRate(), 24, 4.0f);
-    RobotBufferPlayer sWet = RobotBufferPlayer(getSampleRate(), 24, 0.0f);
-    // -------------------------------------------------------------------
-    // Dsp 
-    RobotHexedFilterDSP left;
-    RobotHexedFilterDSP right;
-    RobotWet wetLeft;
-    RobotWet wetRight;
-    // -------------------------------------------------------------------
+    // Resets the filters if NaN or a runaway value shows up
+    RobotHealth health = RobotHealth(0.0);
 
+    ROBOT_TRACE_DECLARE("RobotHexedFilter")
+    // -------------------------------------------------------------------
     DISTRHO_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RobotHexedFilterPlugin)
 };
 
@@ -0,0 +1,99 @@
+/*
+ *  Robot Audio Plugins
+ *
+ *  Copyright (C) 2023      Martin Bångens
+ *  Copyright (c) 2013-2014 Pascal Gauthier
+ *  Copyright (c) 2013-2014 Filatov Vadim
+ *
+ *  Filter taken from the Obxd project :
+ *    https://github.com/asb2m10/dexed
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include "sharedTables.hpp"
+
+#ifndef PI_F
+#define PI_F 3.1415927410125732421875f
+#endif
+
+/*
+ * The constants the Hexed filter derives from the sample rate, cheap
+ * enough to work out in flush()
+ */
+struct RobotHexedRate
+{
+    explicit RobotHexedRate(double srate)
+    {
+        srateInv = 1/srate;
+
+        float rcrate = sqrt((44000/srate));
+        rcor24    = (970.0/44000)*rcrate;
+        rcor24Inv = 1/rcor24;
+
+        bright =  (sin((44000/srate)*(43900/44000) * PI_F * srateInv))/
+                  (cos((44000/srate)*(43900/44000) * PI_F * srateInv));
+
+        dc_r = 1.0-(126.0/srate);
+    }
+
+    float  srateInv;
+    float  rcor24, rcor24Inv;
+    float  bright;
+    float  dc_r;
+};
+
+/*
+ * The cutoff to g table for one sample rate. Built off the audio thread
+ * and shared by all instances through RobotSharedTables, never written
+ * after the constructor.
+ */
+struct RobotHexedTables
+{
+    // Points in the cutoff to g table, error is about 2.5e-5 at 44.1 kHz
+    static const uint32_t kCutOffSize = 2048;
+
+    explicit RobotHexedTables(double srate)
+        : sampleRate(srate)
+    {
+        const float srateInv = RobotHexedRate(srate).srateInv;
+
+        for (uint32_t i=0; i <= kCutOffSize; ++i)
+        {
+            // Same as RobotHexedFilterDSP::setCutOff()
+            double norm = ((exp((double)i/kCutOffSize * log(20.0)) - 1.0) / 19.0) * (19000-60) + 60;
+            double w    = norm * srateInv * PI_F;
+            // keep away from the tan pole at low sample rates
+            if (w > 1.5) w = 1.5;
+            cutOffG[i] = (float)tan(w);
+        }
+    }
+
+    // g for a 0-1 cutoff, linear between table points
+    inline float lookupG(float value) const
+    {
+        if (value < 0.0f) value = 0.0f;
+        if (value > 1.0f) value = 1.0f;
+        const float    x    = value * kCutOffSize;
+        uint32_t       i    = (uint32_t)x;
+        if (i >= kCutOffSize) i = kCutOffSize - 1;
+        const float    frac = x - i;
+        return cutOffG[i] + frac * (cutOffG[i+1] - cutOffG[i]);
+    }
+
+    double sampleRate;
+    float  cutOffG[kCutOffSize+1];
+};
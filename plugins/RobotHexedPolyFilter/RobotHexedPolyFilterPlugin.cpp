@@ -0,0 +1,415 @@
+/*
+ *  Robot Audio Plugins
+ *
+ *  Copyright (C) 2023      Martin Bångens
+ *
+ *  Programing style originally from https://github.com/DISTRHO/DPF-Plugins
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "RobotHexedPolyFilterPlugin.hpp"
+
+START_NAMESPACE_DISTRHO
+
+// --------------------------------------------------------------------------------------------
+
+RobotHexedPolyFilterPlugin::RobotHexedPolyFilterPlugin()
+    : Plugin(paramCount, 1, 0) // parameters, program, states
+{
+    // set default values, the bank is set up by the first activate() so a
+    // host scanning plugins pays for none of it
+    loadProgram(0);
+
+    // Taken now, the values are already in the parameters
+    float values[paramCount];
+    program.take(values);
+}
+
+// --------------------------------------------------------------------------------------------
+// Init
+
+void RobotHexedPolyFilterPlugin::initAudioPort(bool input, uint32_t index, AudioPort& port)
+{
+    port.groupId = kPortGroupStereo;
+
+    Plugin::initAudioPort(input, index, port);
+}
+
+void RobotHexedPolyFilterPlugin::initParameter(uint32_t index, Parameter& parameter)
+{
+    switch (index)
+    {
+    case paramCutOff:
+        parameter.hints      = kParameterIsAutomatable | kParameterIsLogarithmic;
+        parameter.name       = "CutOff";
+        parameter.shortName  = "CutOff";
+        parameter.symbol     = "freq";
+        parameter.unit       = "%";
+        parameter.ranges.def = 100.0f;
+        parameter.ranges.min = 0.0f;
+        parameter.ranges.max = 100.0f;
+        break;
+
+    case paramKeyTrack:
+        parameter.hints      = kParameterIsAutomatable;
+        parameter.name       = "KeyTrack";
+        parameter.shortName  = "KeyTrack";
+        parameter.symbol     = "keytrack";
+        parameter.unit       = "%";
+        parameter.ranges.def = 100.0f;
+        parameter.ranges.min = 0.0f;
+        parameter.ranges.max = 100.0f;
+        break;
+
+    case paramResonance:
+        parameter.hints      = kParameterIsAutomatable | kParameterIsLogarithmic;
+        parameter.name       = "Resonance";
+        parameter.shortName  = "Resonance";
+        parameter.symbol     = "res";
+        parameter.unit       = "%";
+        parameter.ranges.def = 0.0f;
+        parameter.ranges.min = 0.0f;
+        parameter.ranges.max = 100.0f;
+        break;
+
+    case paramMode:
+        parameter.hints      = kParameterIsAutomatable | kParameterIsInteger;
+        parameter.name       = "PoleMode";
+        parameter.shortName  = "PoleMode";
+        parameter.symbol     = "switch";
+        parameter.unit       = "";
+        parameter.ranges.def = 4;
+        parameter.ranges.min = 1;
+        parameter.ranges.max = 4;
+        break;
+
+    case paramRelease:
+        parameter.hints      = kParameterIsAutomatable | kParameterIsLogarithmic;
+        parameter.name       = "Release";
+        parameter.shortName  = "Release";
+        parameter.symbol     = "release";
+        parameter.unit       = "ms";
+        parameter.ranges.def = 200.0f;
+        parameter.ranges.min = 10.0f;
+        parameter.ranges.max = 2000.0f;
+        break;
+
+    case paramWet:
+        parameter.hints      = kParameterIsAutomatable | kParameterIsLogarithmic;
+        parameter.name       = "Wet";
+        parameter.shortName  = "Wet";
+        parameter.symbol     = "percent";
+        parameter.unit       = "%";
+        parameter.ranges.def = 0.0f;
+        parameter.ranges.min = 0.0f;
+        parameter.ranges.max = 100.0f;
+        break;
+
+    }
+}
+
+void RobotHexedPolyFilterPlugin::initProgramName(uint32_t index, String& programName)
+{
+    switch (index)
+    {
+        case 0:
+            programName = "Default";
+            break;
+    }
+}
+
+// -----------------------------------------------------------------------
+// Internal data
+
+float RobotHexedPolyFilterPlugin::getParameterValue(uint32_t index) const
+{
+    switch (index)
+    {
+    case paramCutOff:
+        return fCutOff;
+
+    case paramKeyTrack:
+        return fKeyTrack;
+
+    case paramResonance:
+        return fResonance;
+
+    case paramMode:
+        return fMode;
+
+    case paramRelease:
+        return fRelease;
+
+    case paramWet:
+        return fWet;
+
+    default:
+        return 0.0f;
+    }
+}
+
+void RobotHexedPolyFilterPlugin::setParameterValue(uint32_t index, float value)
+{
+    if (getSampleRate() <= 0.0)
+        return;
+
+    ROBOT_TRACE_EVENT(kParameter, index, value);
+
+    // A program loaded before this value came first, so it lands first
+    float values[paramCount];
+    if (program.take(values))
+        setProgramValues(values);
+
+    switch (index)
+    {
+    case paramCutOff:
+        fCutOff = value;
+        cutoff  = fCutOff*0.01f;
+        break;
+
+    case paramKeyTrack:
+        fKeyTrack = value;
+        bank.setKeyTrack(fKeyTrack*0.01f);
+        break;
+
+    case paramResonance:
+        fResonance = value;
+        resonance  = fResonance*0.01f;
+        break;
+
+    case paramMode:
+        fMode = value;
+        mode  = fMode;
+        break;
+
+    case paramRelease:
+        fRelease = value;
+        bank.setRelease(fRelease);
+        break;
+
+    case paramWet:
+        fWet = value;
+        wet  = fWet*0.01f;
+        break;
+    }
+}
+
+/*
+ * Called off the audio thread while run() may be busy, so only the values
+ * the host reads back change here. run() takes the program at a block,
+ * the smoothed parameters glide to it and held notes keep playing.
+ */
+void RobotHexedPolyFilterPlugin::loadProgram(uint32_t index)
+{
+    float values[paramCount];
+    for (uint32_t p=0; p < paramCount; ++p)
+        values[p] = getParameterValue(p);
+
+    switch (index)
+    {
+    case 0:
+        // Default
+        values[paramCutOff]    = 100.0f;
+        values[paramKeyTrack]  = 100.0f;
+        values[paramResonance] = 0.0f;
+        values[paramMode]      = 4;
+        values[paramRelease]   = 200.0f;
+        values[paramWet]       = 0.0f;
+        break;
+    }
+
+    fCutOff    = values[paramCutOff];
+    fKeyTrack  = values[paramKeyTrack];
+    fResonance = values[paramResonance];
+    fMode      = values[paramMode];
+    fRelease   = values[paramRelease];
+    fWet       = values[paramWet];
+    program.publish(values);
+}
+
+void RobotHexedPolyFilterPlugin::setProgramValues(const float* values)
+{
+    cutoff    = values[paramCutOff]*0.01f;
+    resonance = values[paramResonance]*0.01f;
+    mode      = values[paramMode];
+    wet       = values[paramWet]*0.01f;
+    bank.setKeyTrack(values[paramKeyTrack]*0.01f);
+    bank.setRelease(values[paramRelease]);
+}
+
+// -----------------------------------------------------------------------
+// Process
+
+void RobotHexedPolyFilterPlugin::activate()
+{
+    const double sr = getSampleRate();
+    // Not running, a program loaded since is already in the parameters
+    float values[paramCount];
+    program.take(values);
+    for (uint32_t p=0; p < paramCount; ++p)
+        values[p] = getParameterValue(p);
+
+    // Filter coefficients and the scratch only when the rate changed
+    // since the last activate(), else the voices just start clean
+    if (sr != activeRate)
+    {
+        activeRate = sr;
+        CutOffLPF.setSampleRate(sr/kBlockSize);
+        ResonanceLPF.setSampleRate(sr/kBlockSize);
+        ModeLI.setSampleRate(sr/kBlockSize);
+        WetLI.setSampleRate(sr);
+        bank.flush(sr);
+        // run() works on one block at a time, the bank output for it
+        scratch.allocate(2*RobotScratch::bytes<float>(kBlockSize));
+    }
+    else
+        bank.reset();
+    setProgramValues(values);
+
+    smoothCutOff    = cutoff;
+    smoothResonance = resonance;
+    smoothMode      = mode;
+    bank.setCutOff(smoothCutOff);
+    bank.setResonance(smoothResonance);
+    bank.setMode(smoothMode);
+
+    smoothWet = wet;
+    wetLeft.setWet(smoothWet);
+    wetRight.setWet(smoothWet);
+}
+
+void RobotHexedPolyFilterPlugin::handleMidi(const MidiEvent& event)
+{
+    if (event.size != 3)
+        return;
+
+    const uint8_t status = event.data[0] & 0xF0;
+    const uint8_t note   = event.data[1] & 0x7F;
+    const uint8_t value  = event.data[2] & 0x7F;
+
+    switch (status)
+    {
+    case 0x90:
+        if (value != 0)
+        {
+            bank.noteOn(note, value);
+            break;
+        }
+        // fall through, velocity 0 is a note off
+    case 0x80:
+        bank.noteOff(note);
+        break;
+
+    case 0xB0:
+        // All sound off and all notes off
+        if (note == 120 || note == 123)
+            bank.allNotesOff();
+        break;
+    }
+}
+
+void RobotHexedPolyFilterPlugin::run(const float** inputs, float** outputs, uint32_t frames,
+                                     const MidiEvent* midiEvents, uint32_t midiEventCount)
+{
+    scratch.reset();
+    float* const bufLeft  = scratch.take<float>(kBlockSize);
+    float* const bufRight = scratch.take<float>(kBlockSize);
+    uint32_t ev = 0;
+    // Coefficient updates, only reported to the trace
+    uint32_t updates = 0;
+
+    ROBOT_TRACE_EVENT(kBlockBegin, 0, frames);
+
+    for (uint32_t i=0; i < frames;)
+    {
+        float values[paramCount];
+        if (program.take(values))
+        {
+            setProgramValues(values);
+            ROBOT_TRACE_EVENT(kProgram, 0, 0);
+        }
+
+        for (; ev < midiEventCount && midiEvents[ev].frame <= i; ++ev)
+            handleMidi(midiEvents[ev]);
+
+        // Split the block at the next event so notes start on time
+        uint32_t n = (frames-i < kBlockSize) ? frames-i : kBlockSize;
+        if (ev < midiEventCount && midiEvents[ev].frame < i+n)
+            n = midiEvents[ev].frame - i;
+
+        const float c = CutOffLPF.process(cutoff);
+        if (c != smoothCutOff)
+        {
+            smoothCutOff = c;
+            bank.setCutOff(c);
+            ++updates;
+        }
+        const float r = ResonanceLPF.process(resonance);
+        if (r != smoothResonance)
+        {
+            smoothResonance = r;
+            bank.setResonance(r);
+            ++updates;
+        }
+        const float m = ModeLI.process(mode);
+        if (m != smoothMode)
+        {
+            smoothMode = m;
+            bank.setMode(m);
+            ++updates;
+        }
+
+        bank.process(inputs[0]+i, inputs[1]+i, bufLeft, bufRight, n);
+
+        for (uint32_t j=0; j < n; ++j, ++i)
+        {
+            const float fw = WetLI.process(wet);
+            if (fw != smoothWet)
+            {
+                smoothWet = fw;
+                wetLeft.setWet(fw);
+                wetRight.setWet(fw);
+            }
+            outputs[0][i] = wetLeft.process(inputs[0][i], bufLeft[j]);
+            outputs[1][i] = wetRight.process(inputs[1][i], bufRight[j]);
+        }
+    }
+
+    for (; ev < midiEventCount; ++ev)
+        handleMidi(midiEvents[ev]);
+
+#ifdef ROBOT_TRACE
+    // Voices going to sleep or waking up since the last block
+    const uint32_t active = bank.getActiveVoices();
+    if (active < fTraceVoices)
+        ROBOT_TRACE_EVENT(kSleep, fTraceVoices - active, active);
+    else if (active > fTraceVoices)
+        ROBOT_TRACE_EVENT(kWake, active - fTraceVoices, active);
+    fTraceVoices = active;
+#endif
+    ROBOT_TRACE_EVENT(kCoefficients, 0, updates);
+    ROBOT_TRACE_EVENT(kBlockEnd, 0, frames);
+}
+
+// -----------------------------------------------------------------------
+
+Plugin* createPlugin()
+{
+    return new RobotHexedPolyFilterPlugin();
+}
+
+// -----------------------------------------------------------------------
+
+END_NAMESPACE_DISTRHO
@@ -0,0 +1,174 @@
+/*
+ *  Robot Audio Plugins
+ *
+ *  Copyright (C) 2023      Martin Bångens
+ *
+ *  Programing style originally from https://github.com/DISTRHO/DPF-Plugins
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef ROBOT_HEXED_POLY_FILTER_PLUGIN_HPP_INCLUDED
+#define ROBOT_HEXED_POLY_FILTER_PLUGIN_HPP_INCLUDED
+
+#include "DistrhoPlugin.hpp"
+#include "RobotHexedVoiceBank.hpp"
+#include "wet.hpp"
+#include "smooth.hpp"
+#include "trace.hpp"
+#include "alignedNew.hpp"
+#include "snapshot.hpp"
+#include "scratch.hpp"
+
+START_NAMESPACE_DISTRHO
+
+// -----------------------------------------------------------------------
+
+class RobotHexedPolyFilterPlugin : public Plugin
+{
+    enum Parameters
+    {
+        paramCutOff = 0,
+        paramKeyTrack,
+        paramResonance,
+        paramMode,
+        paramRelease,
+        paramWet,
+        paramCount
+    };
+
+    // Voice coefficients are updated once per block
+    static const uint32_t kBlockSize = 32;
+
+public:
+    RobotHexedPolyFilterPlugin();
+
+    ROBOT_DECLARE_ALIGNED_NEW(RobotHexedPolyFilterPlugin)
+
+protected:
+    // -------------------------------------------------------------------
+    // Information
+
+    const char* getLabel() const noexcept override
+    {
+        return "RobotHexedPolyFilter";
+    }
+
+    const char* getDescription() const override
+    {
+        return "Modified Dexed filter, one key tracked filter per MIDI note";
+    }
+
+    const char* getMaker() const noexcept override
+    {
+        return "Robot Audio";
+    }
+
+    const char* getHomePage() const override
+    {
+        return "https://github.com/noisecode3/ra-plugins#hexed-poly-filter";
+    }
+
+    const char* getLicense() const noexcept override
+    {
+        return "GPL";
+    }
+
+    uint32_t getVersion() const noexcept override
+    {
+        return d_version(1, 0, 0);
+    }
+
+    int64_t getUniqueId() const noexcept override
+    {
+        return d_cconst('r', 'B', 'h', 'P');
+    }
+
+    // -------------------------------------------------------------------
+    // Init
+
+    void initAudioPort(bool input, uint32_t index, AudioPort& port) override;
+    void initParameter(uint32_t index, Parameter& parameter) override;
+    void initProgramName(uint32_t index, String& programName) override;
+
+    // -------------------------------------------------------------------
+    // Internal data
+
+    float getParameterValue(uint32_t index) const override;
+    void  setParameterValue(uint32_t index, float value) override;
+    void  loadProgram(uint32_t index) override;
+
+    // -------------------------------------------------------------------
+    // Process
+
+    void activate() override;
+    void run(const float** inputs, float** outputs, uint32_t frames,
+             const MidiEvent* midiEvents, uint32_t midiEventCount) override;
+
+    // -------------------------------------------------------------------
+
+private:
+    void handleMidi(const MidiEvent& event);
+    // What run() works towards, from a program or the parameters
+    void setProgramValues(const float* values);
+
+    // -------------------------------------------------------------------
+    // Parameters, as the host reads them back
+
+    float fCutOff    = 100.0f;
+    float fKeyTrack  = 100.0f;
+    float fResonance = 0.0f;
+    float fMode      = 4;
+    float fRelease   = 200.0f;
+    float fWet       = 0.0f;
+
+    // Control rate smoothing, one step per block. Rates come from
+    // activate(), they are built without one here.
+    LPFSmooth CutOffLPF    = LPFSmooth(21.32f, 0.0f);
+    LPFSmooth ResonanceLPF = LPFSmooth(21.32f, 0.0f);
+    LISmooth  ModeLI       = LISmooth(21.34f, 0.0f);
+    LISmooth  WetLI        = LISmooth(21.34f, 0.0f);
+    float     smoothCutOff = 1.0f, smoothResonance = 0.0f, smoothMode = 4.0f, smoothWet = 0.0f;
+    // Targets of the smoothing, only run() and setParameterValue() write them
+    float     cutoff = 1.0f, resonance = 0.0f, mode = 4.0f, wet = 0.0f;
+
+    // Program values from loadProgram(), run() takes them at a block
+    RobotSnapshot<paramCount> program;
+
+    // -------------------------------------------------------------------
+    // Dsp
+    // DPF does not hand the plugin the CLAP thread pool, so the bank runs
+    // its groups serially here. Tools set a RobotThreadPool on it.
+    RobotHexedVoiceBank bank;
+    RobotWet wetLeft;
+    RobotWet wetRight;
+    // Block buffers for run(), sized in activate()
+    RobotScratch scratch;
+    // Rate of the last activate(), 0 before the first
+    double activeRate = 0.0;
+
+    ROBOT_TRACE_DECLARE("RobotHexedPolyFilter")
+#ifdef ROBOT_TRACE
+    uint32_t fTraceVoices = 0;
+#endif
+    // -------------------------------------------------------------------
+
+    DISTRHO_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RobotHexedPolyFilterPlugin)
+};
+
+// -----------------------------------------------------------------------
+
+END_NAMESPACE_DISTRHO
+
+#endif // ROBOT_HEXED_POLY_FILTER_PLUGIN_HPP_INCLUDED
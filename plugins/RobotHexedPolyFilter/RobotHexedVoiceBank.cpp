@@ -0,0 +1,306 @@
+/*
+ *  Robot Audio Plugins
+ *
+ *  Copyright (C) 2023      Martin Bångens
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "RobotHexedVoiceBank.hpp"
+#include "curves.hpp"
+
+#define ATTACK_MS 3.0f
+// A released voice under this envelope (-80 dB) goes to sleep
+#define SLEEP_ENV  0.0001f
+
+RobotHexedVoiceBank::RobotHexedVoiceBank(double sampleRate)
+{
+    flush(sampleRate);
+}
+
+void RobotHexedVoiceBank::flush(double srate)
+{
+    sr = (float)srate;
+    for (uint32_t g=0; g < kGroups; ++g)
+    {
+        groups[g].left.flush(srate);
+        groups[g].right.flush(srate);
+    }
+    reset();
+    attack  = 1.0f - expf(-1.0f / (ATTACK_MS * 0.001f * sr));
+    if (release == 0.0f)
+        setRelease(200.0f);
+}
+
+void RobotHexedVoiceBank::reset()
+{
+    for (uint32_t g=0; g < kGroups; ++g)
+        for (uint32_t l=0; l < kLanes; ++l)
+        {
+            groups[g].left.reset(l);
+            groups[g].right.reset(l);
+        }
+    for (uint32_t v=0; v < kVoices; ++v)
+    {
+        env[v]       = 0.0f;
+        envTarget[v] = 0.0f;
+        envRate[v]   = 0.0f;
+        notes[v]     = 60;
+        active[v]    = false;
+        held[v]      = false;
+        dirty[v]     = false;
+        age[v]       = 0;
+    }
+    counter = 0;
+}
+
+// -----------------------------------------------------------------------
+// Voices
+
+void RobotHexedVoiceBank::noteOn(uint8_t note, uint8_t velocity)
+{
+    uint32_t voice = kVoices;
+
+    // Retrigger the same note, else the lowest free voice
+    for (uint32_t v=0; v < kVoices && voice == kVoices; ++v)
+        if (active[v] && notes[v] == note)
+            voice = v;
+    for (uint32_t v=0; v < kVoices && voice == kVoices; ++v)
+        if (!active[v])
+            voice = v;
+
+    // Steal the oldest voice, released ones first
+    if (voice == kVoices)
+    {
+        uint32_t oldest = 0xffffffff;
+        for (uint32_t pass=0; pass < 2 && voice == kVoices; ++pass)
+        {
+            for (uint32_t v=0; v < kVoices; ++v)
+            {
+                if ((pass == 0 && held[v]) || age[v] >= oldest)
+                    continue;
+                oldest = age[v];
+                voice  = v;
+            }
+        }
+    }
+
+    const uint32_t g = voice / kLanes;
+    const uint32_t l = voice % kLanes;
+    if (!active[voice])
+    {
+        groups[g].left.reset(l);
+        groups[g].right.reset(l);
+        env[voice] = 0.0f;
+    }
+    notes[voice]     = note;
+    active[voice]    = true;
+    held[voice]      = true;
+    dirty[voice]     = true;
+    age[voice]       = counter++;
+    envTarget[voice] = velocity * (1.0f/127.0f);
+    envRate[voice]   = attack;
+}
+
+void RobotHexedVoiceBank::noteOff(uint8_t note)
+{
+    for (uint32_t v=0; v < kVoices; ++v)
+    {
+        if (!held[v] || notes[v] != note)
+            continue;
+        held[v]      = false;
+        envTarget[v] = 0.0f;
+        envRate[v]   = release;
+    }
+}
+
+void RobotHexedVoiceBank::allNotesOff()
+{
+    for (uint32_t v=0; v < kVoices; ++v)
+    {
+        held[v]      = false;
+        envTarget[v] = 0.0f;
+        envRate[v]   = release;
+    }
+}
+
+uint32_t RobotHexedVoiceBank::getActiveVoices() const
+{
+    uint32_t count = 0;
+    for (uint32_t v=0; v < kVoices; ++v)
+        count += active[v];
+    return count;
+}
+
+// -----------------------------------------------------------------------
+// Parameters
+
+void RobotHexedVoiceBank::setCutOff(float value)
+{
+    cutoffHz = robotLogsc(value, 60, 19000);
+    for (uint32_t v=0; v < kVoices; ++v)
+        dirty[v] = true;
+}
+
+void RobotHexedVoiceBank::setKeyTrack(float value)
+{
+    keyTrack = value;
+    for (uint32_t v=0; v < kVoices; ++v)
+        dirty[v] = true;
+}
+
+void RobotHexedVoiceBank::setResonance(float value)
+{
+    resonance = value;
+    for (uint32_t v=0; v < kVoices; ++v)
+        dirty[v] = true;
+}
+
+void RobotHexedVoiceBank::setMode(float value)
+{
+    for (uint32_t g=0; g < kGroups; ++g)
+    {
+        groups[g].left.setMode(value);
+        groups[g].right.setMode(value);
+    }
+}
+
+void RobotHexedVoiceBank::setRelease(float ms)
+{
+    release = 1.0f - expf(-1.0f / (ms * 0.001f * sr));
+    for (uint32_t v=0; v < kVoices; ++v)
+        if (active[v] && !held[v])
+            envRate[v] = release;
+}
+
+void RobotHexedVoiceBank::updateVoice(uint32_t v)
+{
+    // Key tracking around middle C
+    float hz = cutoffHz * exp2f(keyTrack * (notes[v] - 60) * (1.0f/12.0f));
+    if (hz < 20.0f) hz = 20.0f;
+    if (hz > 19000.0f) hz = 19000.0f;
+    if (hz > 0.45f*sr) hz = 0.45f*sr;
+
+    const uint32_t g = v / kLanes;
+    const uint32_t l = v % kLanes;
+    groups[g].left.setCutOffHz(l, hz);
+    groups[g].right.setCutOffHz(l, hz);
+    groups[g].left.setResonance(l, resonance);
+    groups[g].right.setResonance(l, resonance);
+    dirty[v] = false;
+}
+
+// -----------------------------------------------------------------------
+// Process
+
+void RobotHexedVoiceBank::process(const float* inLeft, const float* inRight,
+                                  float* outLeft, float* outRight, uint32_t frames)
+{
+    // Groups with a sounding voice, coefficients are updated here so the
+    // tasks only touch their own group
+    uint32_t awake = 0;
+    for (uint32_t g=0; g < kGroups; ++g)
+    {
+        bool sounding = false;
+        for (uint32_t l=0; l < kLanes; ++l)
+        {
+            const uint32_t v = g * kLanes + l;
+            if (!active[v])
+                continue;
+            sounding = true;
+            if (dirty[v])
+                updateVoice(v);
+        }
+        if (sounding)
+            taskGroups[awake++] = g;
+    }
+
+    for (uint32_t i=0; i < frames; i += kMaxFrames)
+    {
+        const uint32_t n = frames-i < kMaxFrames ? frames-i : kMaxFrames;
+        taskLeft   = inLeft + i;
+        taskRight  = inRight + i;
+        taskFrames = n;
+        robotExec(pool, &RobotHexedVoiceBank::processTask, this, awake);
+
+        // Same order as one group after the other
+        for (uint32_t j=0; j < n; ++j)
+            outLeft[i+j] = outRight[i+j] = 0.0f;
+        for (uint32_t k=0; k < awake; ++k)
+        {
+            const Group& group = groups[taskGroups[k]];
+            for (uint32_t j=0; j < n; ++j)
+            {
+                outLeft[i+j]  += group.outLeft[j];
+                outRight[i+j] += group.outRight[j];
+            }
+        }
+    }
+
+    // Put rung out voices to sleep
+    for (uint32_t k=0; k < awake; ++k)
+    {
+        for (uint32_t l=0; l < kLanes; ++l)
+        {
+            const uint32_t v = taskGroups[k] * kLanes + l;
+            if (active[v] && !held[v] && env[v] < SLEEP_ENV)
+                active[v] = false;
+        }
+    }
+}
+
+void RobotHexedVoiceBank::processTask(void* context, uint32_t index)
+{
+    RobotHexedVoiceBank* bank = static_cast<RobotHexedVoiceBank*>(context);
+    bank->processGroup(bank->taskGroups[index]);
+}
+
+void RobotHexedVoiceBank::processGroup(uint32_t g)
+{
+    Group& group = groups[g];
+    const uint32_t base = g * kLanes;
+
+    // The envelopes of all groups share a cache line, work on a copy
+    alignas(16) float e[kLanes], et[kLanes], er[kLanes];
+    for (uint32_t l=0; l < kLanes; ++l)
+    {
+        e[l]  = env[base+l];
+        et[l] = envTarget[base+l];
+        er[l] = envRate[base+l];
+    }
+
+    for (uint32_t i=0; i < taskFrames; ++i)
+    {
+        alignas(16) float xl[kLanes], xr[kLanes], yl[kLanes], yr[kLanes];
+        for (uint32_t l=0; l < kLanes; ++l)
+        {
+            xl[l] = taskLeft[i];
+            xr[l] = taskRight[i];
+        }
+        group.left.tick(xl, yl);
+        group.right.tick(xr, yr);
+
+        float sumLeft = 0.0f, sumRight = 0.0f;
+        for (uint32_t l=0; l < kLanes; ++l)
+        {
+            e[l]     += (et[l] - e[l]) * er[l];
+            sumLeft  += yl[l] * e[l];
+            sumRight += yr[l] * e[l];
+        }
+        group.outLeft[i]  = sumLeft;
+        group.outRight[i] = sumRight;
+    }
+
+    for (uint32_t l=0; l < kLanes; ++l)
+        env[base+l] = e[l];
+}
@@ -0,0 +1,116 @@
+/*
+ *  Robot Audio Plugins
+ *
+ *  Copyright (C) 2023      Martin Bångens
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <cstdint>
+#include "RobotHexedFilterLanes.hpp"
+#include "taskPool.hpp"
+
+/*
+ * Fixed pool of Hexed filter voices, one per held note.
+ * Voices are packed into groups of SIMD width and a group with no sounding
+ * voice is skipped, new notes take the lowest free voice so the sounding
+ * ones stay in as few groups as possible.
+ *
+ * Every sounding group is a task for the RobotTaskPool when there is one,
+ * groups write their own buffers that are summed in order afterwards so
+ * the output does not depend on the threads.
+ */
+class RobotHexedVoiceBank
+{
+public:
+    static const uint32_t kVoices = 16;
+    static const uint32_t kLanes  = ROBOT_HEXED_LANES;
+    static const uint32_t kGroups = kVoices / kLanes;
+    // Frames per task, longer calls are cut into these
+    static const uint32_t kMaxFrames = 64;
+
+    // Nothing set up, flush() before the first process()
+    RobotHexedVoiceBank() {}
+    explicit RobotHexedVoiceBank(double sampleRate);
+
+    // New rate, every voice off
+    void flush(double sr);
+    // Every voice off and its filters clear, the coefficients stay
+    void reset();
+
+    void noteOn(uint8_t note, uint8_t velocity);
+    void noteOff(uint8_t note);
+    void allNotesOff();
+
+    void setCutOff(float value);
+    void setKeyTrack(float value);
+    void setResonance(float value);
+    void setMode(float value);
+    void setRelease(float ms);
+    // nullptr runs the groups one after the other on the calling thread
+    void setTaskPool(RobotTaskPool* value) { pool = value; }
+
+    /*
+     * Adds the voices output for both channels, out is overwritten.
+     * Coefficients are updated once per call so keep frames short.
+     */
+    void process(const float* inLeft, const float* inRight,
+                 float* outLeft, float* outRight, uint32_t frames);
+
+    uint32_t getActiveVoices() const;
+
+private:
+    void updateVoice(uint32_t v);
+    void processGroup(uint32_t g);
+    static void processTask(void* context, uint32_t index);
+
+    // A group per cache line so tasks on other threads do not share one
+    struct alignas(64) Group
+    {
+        RobotHexedFilterLanes<kLanes> left;
+        RobotHexedFilterLanes<kLanes> right;
+        alignas(64) float outLeft[kMaxFrames];
+        alignas(64) float outRight[kMaxFrames];
+    };
+    Group groups[kGroups];
+
+    // -------------------------------------------------------------------
+    // The call the tasks work on
+    RobotTaskPool* pool = nullptr;
+    const float*   taskLeft  = nullptr;
+    const float*   taskRight = nullptr;
+    uint32_t       taskFrames = 0;
+    uint32_t       taskGroups[kGroups];
+
+    // -------------------------------------------------------------------
+    // Per voice, envelope is shared by left and right
+    alignas(16) float env[kVoices] = {};
+    alignas(16) float envTarget[kVoices] = {};
+    alignas(16) float envRate[kVoices] = {};
+    uint8_t  notes[kVoices] = {};
+    bool     active[kVoices] = {};
+    bool     held[kVoices] = {};
+    bool     dirty[kVoices] = {};
+    uint32_t age[kVoices] = {};
+    uint32_t counter = 0;
+
+    // -------------------------------------------------------------------
+    // Shared parameters
+    float sr = 0.0f;
+    float cutoffHz  = 19000.0f;
+    float keyTrack  = 1.0f;
+    float resonance = 0.0f;
+    float attack    = 0.0f;
+    float release   = 0.0f;
+};
@@ -26,7 +26,7 @@
 #define DISTRHO_PLUGIN_URI     "https://github.com/noisecode3/ra-plugins#moog-filter"
 #define DISTRHO_PLUGIN_CLAP_ID "robot.audio.Moog.Filter"
 
-#define DISTRHO_PLUGIN_NUM_INPUTS    2
+#define DISTRHO_PLUGIN_NUM_INPUTS    3
 #define DISTRHO_PLUGIN_NUM_OUTPUTS   2
 #define DISTRHO_PLUGIN_HAS_UI        0
 #define DISTRHO_PLUGIN_IS_RT_SAFE    1
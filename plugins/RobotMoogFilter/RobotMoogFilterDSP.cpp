@@ -0,0 +1,84 @@
+/*
+ *  Robot Audio Plugins
+ *  Copyright (C) 2021  Martin Bångens
+ *
+ *  Dsp algorithms originally from https://github.com/electro-smith/DaisySP
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "RobotMoogFilterDSP.hpp"
+#include "health.hpp"
+#include "curves.hpp"
+
+RobotMoogFilterDSP::RobotMoogFilterDSP(double sampleRate)
+    : fSampleRate((float)sampleRate)
+{
+    moog_reset();
+}
+
+void RobotMoogFilterDSP::setSampleRate(double sampleRate)
+{
+    fSampleRate = (float)sampleRate;
+    fTables.request(sampleRate);
+}
+
+void RobotMoogFilterDSP::moog_reset()
+{
+    for(int i = 0; i < 6; i++)
+    {
+        fDelay[0][i]     = 0.0;
+        fDelay[1][i]     = 0.0;
+    }
+
+    for(int i = 0; i < 3; i++)
+    {
+        fTanhstg[0][i]   = 0.0;
+        fTanhstg[1][i]   = 0.0;
+    }
+}
+
+bool RobotMoogFilterDSP::moog_is_healthy(float limit) const
+{
+    return robotIsHealthy(fDelay[0], 6, limit) && robotIsHealthy(fDelay[1], 6, limit)
+        && robotIsHealthy(fTanhstg[0], 3, limit) && robotIsHealthy(fTanhstg[1], 3, limit);
+}
+
+void RobotMoogFilterDSP::moog_ladder_tune(float freq, float& tune, float& acr) const
+{
+    float f, fc, fc2, fc3, fcr;
+
+    fc        = (freq / fSampleRate);
+    f         = 0.5f * fc;
+    fc2       = fc * fc;
+    fc3       = fc2 * fc2;
+
+    fcr   = 1.8730f * fc3 + 0.4955f * fc2 - 0.6490f * fc + 0.9988f;
+    acr   = -3.9364f * fc2 + 1.8409f * fc + 0.9968f;
+    tune  = (1.0f - expf(-((2 * PI_F) * f * fcr))) / THERMAL;
+}
+
+void RobotMoogFilterDSP::moog_ladder_tune_fast(const float* freq, float* tune, float* acr, uint32_t frames) const
+{
+    const RobotMoogTables* const tables = fTables.get();
+
+    // Table for a new rate still being built
+    if (tables == nullptr)
+    {
+        for (uint32_t i=0; i < frames; ++i)
+            moog_ladder_tune(robotLogsc(freq[i], 20.0f, 22000.0f), tune[i], acr[i]);
+        return;
+    }
+    for (uint32_t i=0; i < frames; ++i)
+        tables->lookup(freq[i], tune[i], acr[i]);
+}
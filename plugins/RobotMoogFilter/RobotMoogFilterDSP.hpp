@@ -0,0 +1,105 @@
+/*
+ *  Robot Audio Plugins
+ *  Copyright (C) 2021  Martin Bångens
+ *
+ *  Dsp algorithms originally from https://github.com/electro-smith/DaisySP
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include "RobotMoogTables.hpp"
+
+#define PI_F 3.1415927410125732421875f
+#define E_F  2.7182818284590452353602f
+#define THERMAL 0.000026f
+
+/*
+ * Stereo Moog ladder, 2x oversampled. Holds the ladder state only, the
+ * plugin owns the parameter ramps and passes tune and resonance in per
+ * sample. No DPF in here so tools can build it on its own.
+ */
+class RobotMoogFilterDSP
+{
+public:
+    explicit RobotMoogFilterDSP(double sampleRate);
+    // Asks for the shared tables of the rate, takes a lock so not from run()
+    void  setSampleRate(double sampleRate);
+    void  moog_reset();
+    // False if any state is NaN, Inf or above limit
+    bool  moog_is_healthy(float limit) const;
+    // Exact tune and acr for a cutoff in Hz
+    void  moog_ladder_tune(float freq, float& tune, float& acr) const;
+    // Same for a block of 0-1 cutoffs, read from the shared table once built
+    void  moog_ladder_tune_fast(const float* freq, float* tune, float* acr, uint32_t frames) const;
+    inline float moog_ladder_process(float in, bool chan, float tune, float res4);
+    static inline float moog_tanh(float x);
+protected:
+    float fDelay[2][6];
+    float fTanhstg[2][3];
+
+    float fSampleRate;
+    // Rate dependent tables, shared by every instance
+    RobotTableSlot<RobotMoogTables> fTables;
+};
+
+// -----------------------------------------------------------------------
+// Called per sample from the plugin, kept here so they inline
+
+inline float RobotMoogFilterDSP::moog_tanh(float x)
+{
+    int sign = 1;
+    if(x < 0)
+    {
+        sign = -1;
+        x    = -x;
+        return x * sign;
+    }
+    else if(x >= 4.0f)
+    {
+        return sign;
+    }
+    else if(x < 0.5f)
+    {
+        return x * sign;
+    }
+    return sign * tanhf(x);
+}
+
+inline float RobotMoogFilterDSP::moog_ladder_process(float in, bool chan, float tune, float res4)
+{
+    float  stg[4];
+
+    for(int j = 0; j < 2; j++)
+    {
+        in -= res4 * fDelay[chan][5];
+        fDelay[chan][0] = stg[0]
+            = fDelay[chan][0] + tune * (moog_tanh(in * THERMAL) - fTanhstg[chan][0]);
+        for(int k = 1; k < 4; k++)
+        {
+            in     = stg[k - 1];
+
+            stg[k] = fDelay[chan][k] + tune *
+                ((fTanhstg[chan][k - 1] = moog_tanh(in * THERMAL)) -
+                 (k != 3 ? fTanhstg[chan][k] : moog_tanh(fDelay[chan][k] * THERMAL)));
+
+            fDelay[chan][k] = stg[k];
+        }
+        fDelay[chan][5] = (stg[3] + fDelay[chan][4]) * 0.5f;
+        fDelay[chan][4] =  stg[3];
+    }
+    return fDelay[chan][5];
+}
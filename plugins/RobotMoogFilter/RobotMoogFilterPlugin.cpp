@@ -20,10 +20,8 @@
  */
 
 #include "RobotMoogFilterPlugin.hpp"
-
-#define PI_F 3.1415927410125732421875f
-#define E_F  2.7182818284590452353602f
-#define THERMAL 0.000026f
+#include <cstring>
+#include "curves.hpp"
 
 START_NAMESPACE_DISTRHO
 
@@ -32,13 +30,36 @@ START_NAMESPACE_DISTRHO
 RobotMoogFilterPlugin::RobotMoogFilterPlugin()
     : Plugin(paramCount, 1, 0) // parameters, program, states
 {
-    // set default values
+    // set default values, the dsp is set up by the first activate() so a
+    // host scanning plugins pays for none of it
     loadProgram(0);
+
+    // Taken now, parameters the host sets before activate() come after it
+    float values[paramCount];
+    if (fProgram.take(values))
+        moog_set_program(values);
 }
 
 // -----------------------------------------------------------------------
 // Init
 
+void RobotMoogFilterPlugin::initAudioPort(bool input, uint32_t index, AudioPort& port)
+{
+    if (input && index == 2)
+    {
+        port.hints   = kAudioPortIsCV | kCVPortHasBipolarRange;
+        port.groupId = kPortGroupNone;
+        Plugin::initAudioPort(input, index, port);
+        port.name    = "CutOff CV";
+        port.symbol  = "freq_cv";
+        return;
+    }
+
+    port.groupId = kPortGroupStereo;
+
+    Plugin::initAudioPort(input, index, port);
+}
+
 void RobotMoogFilterPlugin::initParameter(uint32_t index, Parameter& parameter)
 {
     switch (index)
@@ -73,6 +94,26 @@ void RobotMoogFilterPlugin::initParameter(uint32_t index, Parameter& parameter)
         parameter.ranges.max = 100.0f;
         break;
 
+    case paramFreqMod:
+        parameter.hints      = kParameterIsAutomatable;
+        parameter.name       = "CutOffMod";
+        parameter.symbol     = "freqmod";
+        parameter.unit       = "%";
+        parameter.ranges.def = 0.0f;
+        parameter.ranges.min = 0.0f;
+        parameter.ranges.max = 100.0f;
+        break;
+
+    case paramRecoveries:
+        parameter.hints      = kParameterIsOutput | kParameterIsInteger;
+        parameter.name       = "Recoveries";
+        parameter.symbol     = "recoveries";
+        parameter.unit       = "";
+        parameter.ranges.def = 0.0f;
+        parameter.ranges.min = 0.0f;
+        parameter.ranges.max = 1000000.0f;
+        break;
+
     }
 }
 
@@ -102,6 +143,12 @@ float RobotMoogFilterPlugin::getParameterValue(uint32_t index) const
     case paramWet:
         return fWet;
 
+    case paramFreqMod:
+        return fFreqMod;
+
+    case paramRecoveries:
+        return (float)fHealth.getRecoveries();
+
     default:
         return 0.0f;
     }
@@ -112,208 +159,403 @@ void RobotMoogFilterPlugin::setParameterValue(uint32_t index, float value)
     if (getSampleRate() <= 0.0)
         return;
 
+    ROBOT_TRACE_EVENT(kParameter, index, value);
+
+    // A program loaded before this value came first, so it lands first
+    float values[paramCount];
+    if (fProgram.take(values))
+        moog_set_program(values);
+
     switch (index)
     {
     case paramFreq:
         fFreq        = value;
-        fChangeFreq  = fFreq-fFreqOld;
+        fFreqTarget  = value;
         fFreqFall    = true;
         break;
 
     case paramRes:
         fRes         = value;
-        fChangeRes   = fRes-fResOld;
+        fResTarget   = value;
         fResFall     = true;
         break;
 
     case paramWet:
         fWet         = value;
-        fChangeWet   = fWet-fWetOld;
+        fWetTarget   = value;
         fWetFall     = true;
         break;
+
+    case paramFreqMod:
+        fFreqMod     = value;
+        fFreqModTarget = value;
+        break;
     }
 }
 
+/*
+ * Called off the audio thread while run() may be busy, so only the values
+ * the host reads back change here. run() takes the program at a
+ * micro-block and ramps to it.
+ */
 void RobotMoogFilterPlugin::loadProgram(uint32_t index)
 {
+    float values[paramCount];
+    for (uint32_t p=0; p < paramCount; ++p)
+        values[p] = getParameterValue(p);
+
     switch (index)
     {
     case 0:
         // Default
-        fFreq = 100.0f;
-        fRes  = 0.0f;
-        fWet  = 0.0f;
-        activate();
+        values[paramFreq]    = 100.0f;
+        values[paramRes]     = 0.0f;
+        values[paramWet]     = 0.0f;
+        values[paramFreqMod] = 0.0f;
         break;
     }
+
+    fFreq    = values[paramFreq];
+    fRes     = values[paramRes];
+    fWet     = values[paramWet];
+    fFreqMod = values[paramFreqMod];
+    fProgram.publish(values);
 }
 
 // -----------------------------------------------------------------------
 // Process
 
-float RobotMoogFilterPlugin::logsc(float param, const float min, const float max, const float rolloff = 19.0f)
+float RobotMoogFilterPlugin::logsc(float param, const float min, const float max)
 {
-    return ((expf(param * logf(rolloff+1)) - 1.0f) / (rolloff)) * (max-min) + min;
+    return robotLogsc(param, min, max);
 }
 
 void RobotMoogFilterPlugin::activate()
 {
-    fSampleRate = (float)getSampleRate();
+    const double sr = getSampleRate();
 
-    for(int i = 0; i < 6; i++)
-    {
-        fDelay[0][i]     = 0.0;
-        fDelay[1][i]     = 0.0;
-    }
+    // Not running, a program loaded since is simply set
+    float values[paramCount];
+    if (fProgram.take(values))
+        moog_set_program(values);
 
-    for(int i = 0; i < 3; i++)
+    // The tables, the scratch and the times only when the rate changed
+    // since the last activate(), else the ladder just starts clean
+    if (sr != fActiveRate)
     {
-        fTanhstg[0][i]   = 0.0;
-        fTanhstg[1][i]   = 0.0;
+        fActiveRate = sr;
+        fDsp.setSampleRate(sr);
+        fFadeFrames  = (uint32_t)(sr*0.001*kFadeMs);
+        if (fFadeFrames == 0)
+            fFadeFrames = 1;
+        fRampFrames  = (uint32_t)(sr*0.001*kRampMs);
+        if (fRampFrames == 0)
+            fRampFrames = 1;
+        // run() works on one micro-block at a time, cutoff and tuning for it
+        fScratch.allocate(3*RobotScratch::bytes<float>(kBlockSize));
+        fHealth.setSampleRate(sr);
     }
-
-    moog_ladder_tune(logsc(0.01*fFreq, 20.0, 22000.0));
-    fWetVol      = 1.0f - exp(-0.01f*fWet);
-    fWetVol      = fWetVol + 0.367879*(0.01f*fWet);
-
-    fFreqOld     = fFreq;
-    fResOld      = fRes;
-    fWetOld      = fWet;
+    else
+        fHealth.reset();
+    // Same tables as fDsp, so a fade never frees them in run()
+    fDspFade     = fDsp;
+    fFade        = 0;
+    fDsp.moog_reset();
+
+    fDsp.moog_ladder_tune(logsc(0.01*fFreqTarget, 20.0, 22000.0), fTune, fAcr);
+    fFreqTuned   = 0.01*fFreqTarget;
+    fTuneNow     = fTune;
+    fAcrNow      = fAcr;
+    fTuneRatio   = 1.0f;
+    fAcrStep     = 0.0f;
+    fWetVol      = robotWet(0.01f*fWetTarget);
+
+    fFreqOld     = fFreqTarget;
+    fResOld      = fResTarget;
+    fWetOld      = fWetTarget;
 
     fFreqFall    = false;
     fResFall     = false;
     fWetFall     = false;
+    fSamplesFallFreq = 0;
+    fSamplesFallRes  = 0;
+    fSamplesFallWet  = 0;
+    fChangeFreq  = 0.0f;
+    fChangeRes   = 0.0f;
+    fChangeWet   = 0.0f;
+
+    fPhase       = 0;
+    fBypass      = false;
 }
 
 void RobotMoogFilterPlugin::deactivate()
 {
-    //TODO
+    // Nothing to let go of, activate() at the same rate picks the tables
+    // and the scratch up again
 }
 
-float RobotMoogFilterPlugin::moog_tanh(float x)
-{
-    int sign = 1;
-    if(x < 0)
-    {
-        sign = -1;
-        x    = -x;
-        return x * sign;
-    }
-    else if(x >= 4.0f)
-    {
-        return sign;
-    }
-    else if(x < 0.5f)
-    {
-        return x * sign;
-    }
-    return sign * tanhf(x);
-}
+// -----------------------------------------------------------------------
+// Parameters
 
-void RobotMoogFilterPlugin::moog_ladder_tune(float freq)
+/*
+ * Starts a ramp to target from wherever the running one has got to
+ */
+void RobotMoogFilterPlugin::moog_ramp_start(float& old, float& change, uint32_t& samples, float target)
 {
-    float f, fc, fc2, fc3, fcr;
-
-    fc        = (freq / fSampleRate);
-    f         = 0.5f * fc;
-    fc2       = fc * fc;
-    fc3       = fc2 * fc2;
-
-    fcr   = 1.8730f * fc3 + 0.4955f * fc2 - 0.6490f * fc + 0.9988f;
-    fAcr  = -3.9364f * fc2 + 1.8409f * fc + 0.9968f;
-    fTune = (1.0f - expf(-((2 * PI_F) * f * fcr))) / THERMAL;
+    if (samples > 0)
+        old += ((fRampFrames-samples)*(1.0f/fRampFrames))*change;
+    change  = target-old;
+    samples = fRampFrames;
 }
 
-float RobotMoogFilterPlugin::moog_ladder_process(float in, bool chan)
+float RobotMoogFilterPlugin::moog_freq_step()
 {
-
-// -----------------------------------------------------------------------
-// Parameters
-
-    float  res4;
-
     if (fSamplesFallFreq > 1)
     {
-        float steps   = 1.0f/fFrames;
-        float freqAdd = ((fFrames-fSamplesFallFreq+1)*steps)*(fChangeFreq);
-        moog_ladder_tune(logsc(0.01*(fFreqOld+freqAdd), 20.0, 22000.0));
+        float steps   = 1.0f/fRampFrames;
+        float freqAdd = ((fRampFrames-fSamplesFallFreq+1)*steps)*(fChangeFreq);
         fSamplesFallFreq--;
+        return 0.01*(fFreqOld+freqAdd);
+    }
+    if (fSamplesFallFreq == 1)
+    {
+        // Done, hold the end until the next ramp starts
+        fFreqOld += fChangeFreq; fChangeFreq = 0.0f; fSamplesFallFreq = 0;
     }
-    else { moog_ladder_tune(logsc(0.01*fFreq, 20.0, 22000.0)); fFreqOld = fFreq; fFreqFall = false; }
+    return 0.01*fFreqOld;
+}
 
+float RobotMoogFilterPlugin::moog_res_step()
+{
     if (fSamplesFallRes > 1)
     {
-        float steps  = 1.0f/fFrames;
-        float resAdd = ((fFrames-fSamplesFallRes+1)*steps)*(fChangeRes);
-        res4         = 4.0f * logsc(0.01*(fResOld+resAdd), 0.0, 0.95) * fAcr;
+        float steps  = 1.0f/fRampFrames;
+        float resAdd = ((fRampFrames-fSamplesFallRes+1)*steps)*(fChangeRes);
         fSamplesFallRes--;
+        return 4.0f * logsc(0.01*(fResOld+resAdd), 0.0, 0.95);
+    }
+    if (fSamplesFallRes == 1)
+    {
+        fResOld += fChangeRes; fChangeRes = 0.0f; fSamplesFallRes = 0;
     }
-    else { res4 = 4.0f * logsc(0.01*fRes, 0.0, 0.95) * fAcr; fResOld = fRes; fResFall = false; }
+    return 4.0f * logsc(0.01*fResOld, 0.0, 0.95);
+}
 
+void RobotMoogFilterPlugin::moog_wet_step()
+{
     if (fSamplesFallWet > 1)
     {
-        float steps  = 1.0f/fFrames;
-        float wetAdd = ((fFrames-fSamplesFallWet+1)*steps)*(fChangeWet);
-        fWetVol      = 1.0f - exp(-0.01f*(fWetOld+wetAdd));
-        fWetVol      = fWetVol + 0.367879*(0.01f*(fWetOld+wetAdd));
+        float steps  = 1.0f/fRampFrames;
+        float wetAdd = ((fRampFrames-fSamplesFallWet+1)*steps)*(fChangeWet);
+        fWetVol      = robotWet(0.01f*(fWetOld+wetAdd));
         fSamplesFallWet--;
     }
-    else
+    else if (fSamplesFallWet == 1)
     {
-        fWetOld      = fWet;
-        fWetVol      = 1.0f - exp(-0.01f*fWet);
-        fWetVol      = fWetVol + 0.367879*(0.01f*fWet);
-        fWetFall     = false;
+        fWetOld     += fChangeWet; fChangeWet = 0.0f; fSamplesFallWet = 0;
+        fWetVol      = robotWet(0.01f*fWetOld);
     }
+}
 
 // -----------------------------------------------------------------------
 // Filter
 
-    float  stg[4];
+void RobotMoogFilterPlugin::moog_set_program(const float* values)
+{
+    fFreqTarget  = values[paramFreq];
+    fResTarget   = values[paramRes];
+    fWetTarget   = values[paramWet];
+    fFreqModTarget = values[paramFreqMod];
+    fFreqFall    = true;
+    fResFall     = true;
+    fWetFall     = true;
+}
 
-    for(int j = 0; j < 2; j++)
+/*
+ * A program lands at a micro-block. The ladder as it is keeps running
+ * with its tuning and fades out, fDsp starts clean like activate() would
+ * leave it and fades in while the parameters ramp to the program. Copying
+ * the ladder does not allocate, the tables are shared.
+ */
+void RobotMoogFilterPlugin::moog_start_program(const float* values)
+{
+    if (!fBypass)
     {
-        in -= res4 * fDelay[chan][5];
-        fDelay[chan][0] = stg[0]
-            = fDelay[chan][0] + fTune * (moog_tanh(in * THERMAL) - fTanhstg[chan][0]);
-        for(int k = 1; k < 4; k++)
-        {
-            in     = stg[k - 1];
- 
-            stg[k] = fDelay[chan][k] + fTune *
-                ((fTanhstg[chan][k - 1] = moog_tanh(in * THERMAL)) -
-                 (k != 3 ? fTanhstg[chan][k] : moog_tanh(fDelay[chan][k] * THERMAL)));
-
-            fDelay[chan][k] = stg[k];
-        }
-        fDelay[chan][5] = (stg[3] + fDelay[chan][4]) * 0.5f;
-        fDelay[chan][4] =  stg[3];
+        fDspFade  = fDsp;
+        fFadeTune = fTuneNow;
+        fFadeRes4 = 4.0f * logsc(0.01*fResOld, 0.0, 0.95) * fAcrNow;
+        fFade     = fFadeFrames;
+        fDsp.moog_reset();
     }
-    return fDelay[chan][5];
+    moog_set_program(values);
+    ROBOT_TRACE_EVENT(kProgram, 0, fFade);
+}
+
+inline void RobotMoogFilterPlugin::moog_fade_step(float in1, float in2, float& lp1, float& lp2)
+{
+    const float old1 = fDspFade.moog_ladder_process(in1, 0, fFadeTune, fFadeRes4);
+    const float old2 = fDspFade.moog_ladder_process(in2, 1, fFadeTune, fFadeRes4);
+    const float t    = 1.0f - fFade*(1.0f/fFadeFrames);
+    lp1 = old1 + (lp1 - old1)*t;
+    lp2 = old2 + (lp2 - old2)*t;
+    --fFade;
 }
 
 void RobotMoogFilterPlugin::run(const float** inputs, float** outputs, uint32_t frames)
 {
     const float* in1  = inputs[0];
     const float* in2  = inputs[1];
+    const float* cv   = inputs[2];
     float*       out1 = outputs[0];
     float*       out2 = outputs[1];
 
-    fFrames = frames;
-    if (fFreqFall) fSamplesFallFreq = frames;
-    if (fResFall)  fSamplesFallRes  = frames;
-    if (fWetFall)  fSamplesFallWet  = frames;
+    fScratch.reset();
+    float* const freq = fScratch.take<float>(kBlockSize);
+    float* const tune = fScratch.take<float>(kBlockSize);
+    float* const acr  = fScratch.take<float>(kBlockSize);
+    float values[paramCount];
+    // Exact tunings, only reported to the trace
+    uint32_t updates = 0;
+
+    ROBOT_TRACE_EVENT(kBlockBegin, 0, frames);
 
-    for (uint32_t i=0; i < frames; ++i)
+    for (uint32_t i=0; i < frames;)
     {
-        float fout1, fout2;
+        // Ramps start and tunings land on the micro-block grid, so the
+        // output does not depend on how the host cuts its buffers
+        if (fPhase == 0)
+        {
+            if (fProgram.take(values))
+                moog_start_program(values);
+
+            if (fFreqFall) moog_ramp_start(fFreqOld, fChangeFreq, fSamplesFallFreq, fFreqTarget);
+            if (fResFall)  moog_ramp_start(fResOld,  fChangeRes,  fSamplesFallRes,  fResTarget);
+            if (fWetFall)  moog_ramp_start(fWetOld,  fChangeWet,  fSamplesFallWet,  fWetTarget);
+            fFreqFall = fResFall = fWetFall = false;
+
+            const bool bypass = fSamplesFallWet == 0 && fWetOld == 0.0f;
+            if (fBypass && !bypass)
+            {
+                // Waking up, start from a clean ladder while wet ramps in
+                // from 0 so the old state does not click
+                fDsp.moog_reset();
+                ROBOT_TRACE_EVENT(kWake, 0, 2);
+            }
+            else if (!fBypass && bypass)
+            {
+                fFade = 0;
+                ROBOT_TRACE_EVENT(kSleep, 0, 0);
+            }
+            fBypass = bypass;
+        }
+        const bool mod = fFreqModTarget != 0.0f;
+        const uint32_t n = (frames-i < kBlockSize-fPhase) ? frames-i : kBlockSize-fPhase;
+
+        if (fBypass)
+        {
+            if (out1 != in1)
+                std::memcpy(out1+i, in1+i, sizeof(float)*n);
+            if (out2 != in2)
+                std::memcpy(out2+i, in2+i, sizeof(float)*n);
+            i += n;
+            fPhase = (fPhase+n) & (kBlockSize-1);
+            continue;
+        }
+
+        // Cutoff for every sample of the block
+        for (uint32_t j=0; j < n; ++j)
+            freq[j] = moog_freq_step();
+
+        if (mod)
+        {
+            for (uint32_t j=0; j < n; ++j)
+                freq[j] += 0.01f*fFreqModTarget*cv[i+j];
+            fDsp.moog_ladder_tune_fast(freq, tune, acr, n);
+
+            // Where the ladder is, so the exact path takes over from here
+            // when the depth goes back to 0
+            fTune      = fTuneNow = tune[n-1];
+            fAcr       = fAcrNow  = acr[n-1];
+            fFreqTuned = freq[n-1];
+            fTuneRatio = 1.0f;
+            fAcrStep   = 0.0f;
+        }
+        else
+        {
+            // Exact tuning on every kControlSize grid point, the ladder
+            // gets there by the next one, tune geometrically and acr
+            // linearly
+            for (uint32_t j=0; j < n; ++j)
+            {
+                const uint32_t pos = (fPhase+j) & (kControlSize-1);
+                if (pos == 0)
+                {
+                    if (freq[j] != fFreqTuned)
+                    {
+                        fDsp.moog_ladder_tune(logsc(freq[j], 20.0, 22000.0), fTune, fAcr);
+                        fFreqTuned = freq[j];
+                        ++updates;
+                    }
+                    if (fTune != fTuneNow || fAcr != fAcrNow)
+                    {
+                        fTuneRatio = powf(fTune/fTuneNow, 1.0f/kControlSize);
+                        fAcrStep   = (fAcr-fAcrNow)*(1.0f/kControlSize);
+                    }
+                    else
+                    {
+                        fTuneRatio = 1.0f;
+                        fAcrStep   = 0.0f;
+                    }
+                }
+                if (pos == kControlSize-1)
+                {
+                    fTuneNow = fTune;
+                    fAcrNow  = fAcr;
+                }
+                else
+                {
+                    fTuneNow *= fTuneRatio;
+                    fAcrNow  += fAcrStep;
+                }
+                tune[j] = fTuneNow;
+                acr[j]  = fAcrNow;
+            }
+        }
+
+        for (uint32_t j=0; j < n; ++j, ++i)
+        {
+            float fout1, fout2;
+            float res4 = moog_res_step() * acr[j];
+            moog_wet_step();
 
-        fout1   = ((in1[i]*(1.0f-fWetVol)) + (moog_ladder_process(in1[i], 0)*fWetVol));
-        fout2   = ((in2[i]*(1.0f-fWetVol)) + (moog_ladder_process(in2[i], 1)*fWetVol));
+            float lp1 = fDsp.moog_ladder_process(in1[i], 0, tune[j], res4);
+            float lp2 = fDsp.moog_ladder_process(in2[i], 1, tune[j], res4);
+            if (fFade > 0)
+                moog_fade_step(in1[i], in2[i], lp1, lp2);
 
-        out1[i] = fout1;
-        out2[i] = fout2;
+            fout1   = ((in1[i]*(1.0f-fWetVol)) + (lp1*fWetVol));
+            fout2   = ((in2[i]*(1.0f-fWetVol)) + (lp2*fWetVol));
+
+            out1[i] = fout1;
+            out2[i] = fout2;
+        }
+        fPhase = (fPhase+n) & (kBlockSize-1);
+    }
+
+    // A handful of state floats per block, well below the ladder cost. The
+    // fading ladder is checked too, it keeps a NaN it picked up
+    const bool healthy = fDsp.moog_is_healthy(RobotHealth::kLimit)
+                      && fDspFade.moog_is_healthy(RobotHealth::kLimit);
+    if (!fHealth.process(outputs, 2, frames, healthy))
+    {
+        fDsp.moog_reset();
+        fDspFade.moog_reset();
+        fFade = 0;
+        ROBOT_TRACE_EVENT(kRecover, 0, fHealth.getRecoveries());
     }
+
+    ROBOT_TRACE_EVENT(kCoefficients, 0, updates);
+    ROBOT_TRACE_EVENT(kBlockEnd, 0, frames);
 }
 
 // -----------------------------------------------------------------------
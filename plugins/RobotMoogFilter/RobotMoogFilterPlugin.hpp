@@ -22,6 +22,12 @@
 #define ROBOT_MOOG_FILTER_PLUGIN_HPP_INCLUDED
 
 #include "DistrhoPlugin.hpp"
+#include "RobotMoogFilterDSP.hpp"
+#include "trace.hpp"
+#include "health.hpp"
+#include "snapshot.hpp"
+#include "scratch.hpp"
+#include "alignedNew.hpp"
 
 START_NAMESPACE_DISTRHO
 
@@ -35,11 +41,25 @@ public:
         paramFreq = 0,
         paramRes,
         paramWet,
+        paramFreqMod,
+        paramRecoveries,
         paramCount
     };
 
+    // Fixed micro-block, run() cuts the host buffer on this grid and the
+    // grid carries over between calls
+    static const uint32_t kBlockSize = 32;
+    // Samples between exact tunings, a divisor of kBlockSize
+    static const uint32_t kControlSize = 16;
+    // Parameter ramp length, the same for every host buffer size
+    static constexpr float kRampMs = 10.0f;
+    // Crossfade after a program change
+    static constexpr float kFadeMs = 10.0f;
+
     RobotMoogFilterPlugin();
 
+    ROBOT_DECLARE_ALIGNED_NEW(RobotMoogFilterPlugin)
+
 protected:
     // -------------------------------------------------------------------
     // Information
@@ -82,6 +102,7 @@ protected:
     // -------------------------------------------------------------------
     // Init
 
+    void initAudioPort(bool input, uint32_t index, AudioPort& port) override;
     void initParameter(uint32_t index, Parameter& parameter) override;
     void initProgramName(uint32_t index, String& programName);
 
@@ -104,12 +125,22 @@ protected:
 private:
 
     // -------------------------------------------------------------------
-    // Parameters
+    // Parameters, as the host reads them back
 
     float fFreq = 100.0f;
     float fRes  = 0.0f;
     float fWet  = 0.0f;
+    float fFreqMod = 0.0f;
+
+    // What run() ramps to, only setParameterValue() and moog_set_program()
+    // write them
+    float fFreqTarget = 100.0f;
+    float fResTarget  = 0.0f;
+    float fWetTarget  = 0.0f;
+    float fFreqModTarget = 0.0f;
 
+    // The Fall flags mark a new value from setParameterValue(), its ramp
+    // starts at the next micro-block
     uint32_t fSamplesFallFreq = 0;
     bool     fFreqFall = false;
     float    fChangeFreq = 0.0f;
@@ -122,20 +153,50 @@ private:
     bool     fWetFall = false;
     float    fChangeWet = 0.0f;
 
-    uint32_t fFrames;
+    uint32_t fRampFrames = 1;
+    // Position in the current micro-block
+    uint32_t fPhase = 0;
+    // Wet is 0 and settled, the ladder sleeps and the input is copied
+    bool     fBypass = false;
+
+    // Program values from loadProgram(), run() takes them at a micro-block
+    RobotSnapshot<paramCount> fProgram;
 
     // -------------------------------------------------------------------
     // Dsp 
 
-    float fSampleRate, fAcr, fTune, fWetVol, fFreqOld, fResOld, fWetOld;
-
-    float fDelay[2][6];
-    float fTanhstg[2][3];
-
-    float logsc(float param, const float min, const float max, const float rolloff);
-    float moog_tanh(float x);
-    void  moog_ladder_tune(float freq);
-    float moog_ladder_process(float in, bool chan);
+    float fAcr, fTune, fWetVol, fFreqOld, fResOld, fWetOld;
+    // 0-1 cutoff that fTune and fAcr were last computed for
+    float fFreqTuned;
+    // Tuning the ladder runs with, moves to fTune and fAcr over kControlSize
+    float fTuneNow, fAcrNow, fTuneRatio, fAcrStep;
+
+    RobotMoogFilterDSP fDsp = RobotMoogFilterDSP(0.0);
+    // The ladder from before a program change fades out over fFadeFrames
+    // with the tuning it had, while fDsp fades in from a clean state
+    RobotMoogFilterDSP fDspFade = RobotMoogFilterDSP(0.0);
+    float    fFadeTune = 0.0f, fFadeRes4 = 0.0f;
+    uint32_t fFade = 0;
+    uint32_t fFadeFrames = 1;
+
+    // Block buffers for run(), sized in activate()
+    RobotScratch fScratch;
+    // Rate of the last activate(), 0 before the first
+    double fActiveRate = 0.0;
+
+    // Resets the ladder if NaN or a runaway value shows up
+    RobotHealth fHealth = RobotHealth(0.0);
+
+    ROBOT_TRACE_DECLARE("RobotMoogFilter")
+
+    float logsc(float param, const float min, const float max);
+    void  moog_ramp_start(float& old, float& change, uint32_t& samples, float target);
+    float moog_freq_step();
+    float moog_res_step();
+    void  moog_wet_step();
+    void  moog_set_program(const float* values);
+    void  moog_start_program(const float* values);
+    inline void moog_fade_step(float in1, float in2, float& lp1, float& lp2);
 
     // -------------------------------------------------------------------
 
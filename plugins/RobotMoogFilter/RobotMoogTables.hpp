@@ -0,0 +1,70 @@
+/*
+ *  Robot Audio Plugins
+ *  Copyright (C) 2021  Martin Bångens
+ *
+ *  Dsp algorithms originally from https://github.com/electro-smith/DaisySP
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include "sharedTables.hpp"
+
+/*
+ * moog_ladder_tune() for every 0-1 cutoff at one sample rate.
+ * Shared by all instances through RobotSharedTables, never written
+ * after the constructor.
+ */
+struct RobotMoogTables
+{
+    static const uint32_t kCutOffSize = 2048;
+
+    explicit RobotMoogTables(double srate)
+        : sampleRate(srate)
+    {
+        const double pi      = 3.14159265358979323846;
+        const double thermal = 0.000026;
+
+        for (uint32_t i=0; i <= kCutOffSize; ++i)
+        {
+            // logsc(p, 20.0, 22000.0) and moog_ladder_tune() in double
+            double freq = ((exp((double)i/kCutOffSize * log(20.0)) - 1.0) / 19.0) * (22000.0-20.0) + 20.0;
+            double fc   = freq / srate;
+            double f    = 0.5 * fc;
+            double fc2  = fc * fc;
+            double fc3  = fc2 * fc2;
+            double fcr  = 1.8730 * fc3 + 0.4955 * fc2 - 0.6490 * fc + 0.9988;
+            acr[i]  = (float)(-3.9364 * fc2 + 1.8409 * fc + 0.9968);
+            tune[i] = (float)((1.0 - exp(-((2 * pi) * f * fcr))) / thermal);
+        }
+    }
+
+    // tune and acr for a 0-1 cutoff, linear between table points
+    inline void lookup(float value, float& tuneOut, float& acrOut) const
+    {
+        if (value < 0.0f) value = 0.0f;
+        if (value > 1.0f) value = 1.0f;
+        const float    x    = value * kCutOffSize;
+        uint32_t       i    = (uint32_t)x;
+        if (i >= kCutOffSize) i = kCutOffSize - 1;
+        const float    frac = x - i;
+        tuneOut = tune[i] + frac * (tune[i+1] - tune[i]);
+        acrOut  = acr[i]  + frac * (acr[i+1]  - acr[i]);
+    }
+
+    double sampleRate;
+    float  tune[kCutOffSize+1];
+    float  acr[kCutOffSize+1];
+};
@@ -0,0 +1,843 @@
+/*
+ *  Robot Audio Plugins
+ *  Copyright (C) 2023  Martin Bångens
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Microbenchmarks of the DSP primitives
+ *
+ * Runs every kernel over a buffer that stays in L1 and reads hardware
+ * counters around it with perf_event_open. When the counters can not be
+ * opened (not Linux, perf_event_paranoid, a container) only wall clock
+ * time is reported. Numbers are per call, best of a few runs.
+ *
+ * --layout times nothing and prints how big each DSP class is and how many
+ * cache lines the members run() touches every sample and every pre filter
+ * block span, at the worst place the class's alignment allows. With the
+ * dpf submodule checked out the plugin classes get their size too.
+ *
+ * --check times nothing either, it runs streams through the filter farm
+ * and through one RobotHexedFilterDSP each and fails when they differ by
+ * more than the fastAtan error.
+ *
+ *     robot-bench [--json] [--calls N] [--layout] [--check] [kernel ...]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "RobotHexedFilterDSP.hpp"
+#include "RobotHexedFilterFarm.hpp"
+#include "RobotHexedVoiceBank.hpp"
+#include "RobotMoogFilterDSP.hpp"
+#include "quality.hpp"
+#include "samplePlayer.hpp"
+#include "smooth.hpp"
+#include "wet.hpp"
+#include "threadPool.hpp"
+
+// The plugins need DPF, only there when the submodule is checked out
+#if defined(__has_include)
+#if __has_include("DistrhoPlugin.hpp")
+#define ROBOT_BENCH_PLUGINS 1
+#include "RobotHexedFilterPlugin.hpp"
+#include "RobotMoogFilterPlugin.hpp"
+#endif
+#endif
+
+// Keeps a result alive, no memory clobber so state stays in registers
+// like it does in the real loops
+template<class T>
+static inline void keep(const T& value)
+{
+    asm volatile("" : : "g"(value));
+}
+
+// -----------------------------------------------------------------------
+// Counters
+
+class PerfCounters
+{
+public:
+    enum Counter
+    {
+        kCycles = 0,
+        kInstructions,
+        kBranchMisses,
+        kL1Misses,
+        kCount
+    };
+
+    PerfCounters()
+    {
+        for (int i=0; i < kCount; ++i)
+            fd[i] = -1;
+#ifdef __linux__
+        const uint64_t l1 = PERF_COUNT_HW_CACHE_L1D
+                          | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                          | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        open(kCycles,       PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+        open(kInstructions, PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+        open(kBranchMisses, PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+        open(kL1Misses,     PERF_TYPE_HW_CACHE, l1);
+#endif
+    }
+
+    ~PerfCounters()
+    {
+#ifdef __linux__
+        for (int i=0; i < kCount; ++i)
+            if (fd[i] >= 0)
+                close(fd[i]);
+#endif
+    }
+
+    bool has(Counter counter) const
+    {
+        return fd[counter] >= 0;
+    }
+
+    bool any() const
+    {
+        for (int i=0; i < kCount; ++i)
+            if (fd[i] >= 0)
+                return true;
+        return false;
+    }
+
+    void start()
+    {
+#ifdef __linux__
+        for (int i=0; i < kCount; ++i)
+        {
+            if (fd[i] < 0)
+                continue;
+            ioctl(fd[i], PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd[i], PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+
+    void stop(uint64_t values[kCount])
+    {
+        for (int i=0; i < kCount; ++i)
+        {
+            values[i] = 0;
+#ifdef __linux__
+            if (fd[i] < 0)
+                continue;
+            ioctl(fd[i], PERF_EVENT_IOC_DISABLE, 0);
+            if (read(fd[i], &values[i], sizeof(values[i])) != sizeof(values[i]))
+                values[i] = 0;
+#endif
+        }
+    }
+
+private:
+#ifdef __linux__
+    void open(Counter counter, uint32_t type, uint64_t config)
+    {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size           = sizeof(attr);
+        attr.type           = type;
+        attr.config         = config;
+        attr.disabled       = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv     = 1;
+        fd[counter] = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+#endif
+
+    int fd[kCount];
+};
+
+// -----------------------------------------------------------------------
+// Kernels
+
+// Opens up the internals of the Hexed filter for single kernel runs
+class HexedProbe : public RobotHexedFilterDSP
+{
+public:
+    HexedProbe() : RobotHexedFilterDSP(48000.0)
+    {
+        flush(48000.0);
+        setCutOff(0.5f);
+        setResonance(0.6f);
+        setMode(4.0f);
+    }
+    using RobotHexedFilterDSP::logsc;
+    using RobotHexedFilterDSP::tptpc;
+    using RobotHexedFilterDSP::NR24;
+    using RobotHexedFilterDSP::preFilter;
+    float getLpc() const { return lpc; }
+
+    // Offsets of what the kernel reads every sample and of the fused pre
+    // filter it reads every kPreBlock samples
+    size_t sampleBegin() const { return offset(&s1); }
+    size_t sampleEnd()   const { return offset(&hpc) + sizeof(hpc); }
+    size_t blockBegin()  const { return offset(preFromState); }
+    size_t blockEnd()    const { return offset(&brl) + sizeof(brl); }
+
+private:
+    size_t offset(const void* member) const
+    {
+        return (const char*)member - (const char*)static_cast<const RobotHexedFilterDSP*>(this);
+    }
+};
+
+// The same for the ladder, its whole state is read every sample
+class MoogProbe : public RobotMoogFilterDSP
+{
+public:
+    MoogProbe() : RobotMoogFilterDSP(48000.0) {}
+    size_t sampleBegin() const { return offset(fDelay); }
+    size_t sampleEnd()   const { return offset(fTanhstg) + sizeof(fTanhstg); }
+
+private:
+    size_t offset(const void* member) const
+    {
+        return (const char*)member - (const char*)static_cast<const RobotMoogFilterDSP*>(this);
+    }
+};
+
+struct Kernel
+{
+    const char* name;
+    // Runs the kernel once per input, returns the number of calls
+    uint32_t (*run)(const float* in, uint32_t count);
+};
+
+static uint32_t runLogsc(const float* in, uint32_t count)
+{
+    static HexedProbe probe;
+    for (uint32_t i=0; i < count; ++i)
+        keep(probe.logsc(in[i], 60, 19000));
+    return count;
+}
+
+static uint32_t runTptpc(const float* in, uint32_t count)
+{
+    static HexedProbe probe;
+    // One state, the serial chain every filter stage has
+    float state = 0.0f;
+    const float g = probe.getG();
+    for (uint32_t i=0; i < count; ++i)
+        keep(probe.tptpc(state, in[i], g));
+    return count;
+}
+
+static uint32_t runNR24(const float* in, uint32_t count)
+{
+    static HexedProbe probe;
+    const float g = probe.getG(), lpc = probe.getLpc();
+    for (uint32_t i=0; i < count; ++i)
+        keep(probe.NR24(in[i], g, lpc));
+    return count;
+}
+
+static uint32_t runMoogTanh(const float* in, uint32_t count)
+{
+    // Inputs are +-1, scale them over the whole curve so every branch runs
+    for (uint32_t i=0; i < count; ++i)
+        keep(RobotMoogFilterDSP::moog_tanh(in[i]*5.0f));
+    return count;
+}
+
+static uint32_t runMoogLadderTune(const float* in, uint32_t count)
+{
+    static RobotMoogFilterDSP dsp(48000.0);
+    float tune, acr;
+    for (uint32_t i=0; i < count; ++i)
+    {
+        dsp.moog_ladder_tune(10000.0f + 9000.0f*in[i], tune, acr);
+        keep(tune);
+        keep(acr);
+    }
+    return count;
+}
+
+static uint32_t runMoogLadderProcess(const float* in, uint32_t count)
+{
+    static RobotMoogFilterDSP dsp(48000.0);
+    float tune, acr;
+    dsp.moog_ladder_tune(1000.0f, tune, acr);
+    for (uint32_t i=0; i < count; ++i)
+        keep(dsp.moog_ladder_process(in[i], 0, tune, 2.0f*acr));
+    return count;
+}
+
+static uint32_t runLISmooth(const float* in, uint32_t count)
+{
+    static LISmooth smooth(21.34f, 48000.0f);
+    // A new target every 2048 calls, the ramp is 1024 so half of the
+    // calls are ramping
+    for (uint32_t i=0; i < count; ++i)
+        keep(smooth.process(in[i & ~2047u]));
+    return count;
+}
+
+static uint32_t runLPFSmooth(const float* in, uint32_t count)
+{
+    static LPFSmooth smooth(10.0f, 48000.0f);
+    for (uint32_t i=0; i < count; ++i)
+        keep(smooth.process(in[i]));
+    return count;
+}
+
+static uint32_t runWet(const float* in, uint32_t count)
+{
+    static RobotWet wet(0.5f);
+    for (uint32_t i=0; i+1 < count; i+=2)
+        keep(wet.process(in[i], in[i+1]));
+    return count/2;
+}
+
+static uint32_t runSetWet(const float* in, uint32_t count)
+{
+    static RobotWet wet;
+    for (uint32_t i=0; i < count; ++i)
+    {
+        wet.setWet(0.5f + 0.5f*in[i]);
+        keep(wet);
+    }
+    return count;
+}
+
+// Per stream sample, compare with RobotHexedFilterDSP::process
+static uint32_t runHexedProcess(const float* in, uint32_t count)
+{
+    static HexedProbe probe;
+    static std::vector<float> out(4096);
+    if (out.size() < count)
+        out.resize(count);
+    probe.process(in, out.data(), count);
+    keep(out[count-1]);
+    return count;
+}
+
+// The DC, 15 Hz and bright filters alone, a block at a time like process
+static uint32_t runHexedPreFilter(const float* in, uint32_t count)
+{
+    static HexedProbe probe;
+    static std::vector<float> out(4096);
+    if (out.size() < count)
+        out.resize(count);
+    probe.preFilter(in, out.data(), count);
+    keep(out[count-1]);
+    return count;
+}
+
+// Stands in for the host's thread pool
+static RobotThreadPool& getPool()
+{
+    static RobotThreadPool pool(4);
+    return pool;
+}
+
+template<bool Pool>
+static uint32_t runHexedFarm(const float* in, uint32_t count)
+{
+    // The input split into streams of 64 frames
+    static const uint32_t kFrames = 64;
+    static RobotHexedFilterFarm farm(48000.0, 0);
+    farm.setTaskPool(Pool ? &getPool() : nullptr);
+    static std::vector<float> out;
+    static std::vector<const float*> ins;
+    static std::vector<float*> outs;
+
+    const uint32_t streams = count / kFrames;
+    if (farm.getStreams() != streams)
+    {
+        farm.setStreams(streams);
+        farm.setCutOff(0.5f);
+        farm.setResonance(0.6f);
+        out.resize(streams * kFrames);
+        ins.resize(streams);
+        outs.resize(streams);
+        for (uint32_t s=0; s < streams; ++s)
+        {
+            ins[s]  = in + s*kFrames;
+            outs[s] = out.data() + s*kFrames;
+        }
+    }
+    farm.process(ins.data(), outs.data(), kFrames);
+    keep(out[0]);
+    return streams * kFrames;
+}
+
+// Per voice sample, all 16 voices sounding in the plugin's 32 frame blocks
+template<bool Pool>
+static uint32_t runVoiceBank(const float* in, uint32_t count)
+{
+    static RobotHexedVoiceBank bank(48000.0);
+    static float outLeft[32], outRight[32];
+    bank.setTaskPool(Pool ? &getPool() : nullptr);
+    if (bank.getActiveVoices() < RobotHexedVoiceBank::kVoices)
+    {
+        bank.setCutOff(0.5f);
+        bank.setResonance(0.6f);
+        for (uint8_t v=0; v < RobotHexedVoiceBank::kVoices; ++v)
+            bank.noteOn(48+v, 100);
+    }
+    for (uint32_t i=0; i+32 <= count; i += 32)
+        bank.process(in+i, in+i, outLeft, outRight, 32);
+    keep(outLeft[31]);
+    return (count & ~31u) * RobotHexedVoiceBank::kVoices;
+}
+
+/*
+ * Quality tiers, per stream sample while the cutoff sweeps. Exact
+ * coefficients every ControlSize samples with g or tune interpolated
+ * geometrically in between, like the plugins do.
+ */
+template<int Quality, uint32_t ControlSize>
+static uint32_t runHexedTier(const float* in, uint32_t count)
+{
+    static HexedProbe probe;
+    static std::vector<float> g(4096), out(4096);
+    if (out.size() < count)
+    {
+        g.resize(count);
+        out.resize(count);
+    }
+    probe.setFast(Quality == kQualityEco);
+
+    float gNow = probe.getG(), gRatio = 1.0f;
+    for (uint32_t i=0; i < count; ++i)
+    {
+        if (i % ControlSize == 0)
+        {
+            probe.setCutOff(0.5f + 0.25f*in[i]);
+            gRatio = ControlSize > 1 ? powf(probe.getG()/gNow, 1.0f/ControlSize) : 1.0f;
+        }
+        gNow = (i % ControlSize == ControlSize-1) ? probe.getG() : gNow*gRatio;
+        g[i] = gNow;
+    }
+    probe.process(in, g.data(), out.data(), count);
+    keep(out[count-1]);
+    return count;
+}
+
+/*
+ * A cutoff sweep the way the plugin's cutoff ramp runs it, exact
+ * coefficients every 16 samples and one process() per 32 frame block,
+ * so the pre filter blocks may go out of date between blocks
+ */
+static uint32_t runHexedSweep(const float* in, uint32_t count)
+{
+    static HexedProbe probe;
+    static float g[32], out[32];
+    static uint32_t step = 0;
+
+    float gNow = probe.getG(), gRatio = 1.0f;
+    for (uint32_t i=0; i+32 <= count; i += 32)
+    {
+        for (uint32_t j=0; j < 32; ++j)
+        {
+            if (j % 16 == 0)
+            {
+                // Up and down over most of the range
+                probe.setCutOff(0.1f + 0.8f*fabsf(1.0f - (step++ & 4095)/2048.0f));
+                gRatio = powf(probe.getG()/gNow, 1.0f/16);
+            }
+            gNow = (j % 16 == 15) ? probe.getG() : gNow*gRatio;
+            g[j] = gNow;
+        }
+        probe.process(in+i, g, out, 32);
+    }
+    keep(out[31]);
+    return count & ~31u;
+}
+
+static const Kernel kernels[] = {
+    { "logsc",               runLogsc },
+    { "tptpc",               runTptpc },
+    { "NR24",                runNR24 },
+    { "moog_tanh",           runMoogTanh },
+    { "moog_ladder_tune",    runMoogLadderTune },
+    { "moog_ladder_process", runMoogLadderProcess },
+    { "LISmooth::process",   runLISmooth },
+    { "LPFSmooth::process",  runLPFSmooth },
+    { "RobotWet::setWet",    runSetWet },
+    { "Hexed pre filter",    runHexedPreFilter },
+    { "Hexed process",       runHexedProcess },
+    { "Hexed farm process",  runHexedFarm<false> },
+    { "Hexed farm, 4 threads", runHexedFarm<true> },
+    { "Hexed voice bank",    runVoiceBank<false> },
+    { "Hexed bank, 4 threads", runVoiceBank<true> },
+    { "Hexed Eco",           runHexedTier<kQualityEco, 32> },
+    { "Hexed Normal",        runHexedTier<kQualityNormal, 16> },
+    { "Hexed High",          runHexedTier<kQualityHigh, 1> },
+    { "Hexed cutoff sweep",  runHexedSweep },
+    { "RobotWet::process",   runWet },
+};
+
+// -----------------------------------------------------------------------
+// Runner
+
+struct Result
+{
+    const char* name;
+    double   ns;
+    double   counters[PerfCounters::kCount];
+};
+
+static Result measure(const Kernel& kernel, PerfCounters& perf, const std::vector<float>& in, uint32_t calls)
+{
+    const uint32_t size   = (uint32_t)in.size();
+    const uint32_t rounds = calls/size > 0 ? calls/size : 1;
+
+    Result best;
+    best.name = kernel.name;
+    best.ns   = 0.0;
+    for (int i=0; i < PerfCounters::kCount; ++i)
+        best.counters[i] = 0.0;
+
+    // Warm up caches, tables and branch predictors
+    kernel.run(in.data(), size);
+
+    for (int run=0; run < 5; ++run)
+    {
+        uint64_t values[PerfCounters::kCount];
+        uint64_t done = 0;
+
+        const auto start = std::chrono::steady_clock::now();
+        perf.start();
+        for (uint32_t r=0; r < rounds; ++r)
+            done += kernel.run(in.data(), size);
+        perf.stop(values);
+        const auto end = std::chrono::steady_clock::now();
+
+        const double ns = std::chrono::duration<double, std::nano>(end - start).count() / done;
+        if (run > 0 && ns >= best.ns)
+            continue;
+        best.ns = ns;
+        for (int i=0; i < PerfCounters::kCount; ++i)
+            best.counters[i] = (double)values[i] / done;
+    }
+    return best;
+}
+
+// One table cell, "-" when the counter is missing
+static void printCell(bool has, double value, int width, int precision)
+{
+    if (has)
+        std::printf(" %*.*f", width, precision, value);
+    else
+        std::printf(" %*s", width, "-");
+}
+
+static void printTable(const std::vector<Result>& results, const PerfCounters& perf)
+{
+    const bool ipc = perf.has(PerfCounters::kCycles) && perf.has(PerfCounters::kInstructions);
+
+    std::printf("%-22s %9s %9s %9s %6s %9s %9s\n",
+                "kernel", "ns/call", "cycles", "instr", "IPC", "br-miss", "L1-miss");
+    for (const Result& r : results)
+    {
+        const double* c = r.counters;
+        std::printf("%-22s %9.3f", r.name, r.ns);
+        printCell(perf.has(PerfCounters::kCycles),       c[PerfCounters::kCycles],       9, 3);
+        printCell(perf.has(PerfCounters::kInstructions), c[PerfCounters::kInstructions], 9, 3);
+        printCell(ipc && c[PerfCounters::kCycles] > 0.0,
+                  c[PerfCounters::kInstructions] / c[PerfCounters::kCycles], 6, 2);
+        printCell(perf.has(PerfCounters::kBranchMisses), c[PerfCounters::kBranchMisses], 9, 4);
+        printCell(perf.has(PerfCounters::kL1Misses),     c[PerfCounters::kL1Misses],     9, 4);
+        std::printf("\n");
+    }
+    if (!perf.any())
+        std::printf("\nHardware counters unavailable, wall clock only "
+                    "(see /proc/sys/kernel/perf_event_paranoid)\n");
+}
+
+static void printJson(const std::vector<Result>& results, const PerfCounters& perf)
+{
+    static const char* const names[PerfCounters::kCount] = {
+        "cycles", "instructions", "branch_misses", "l1d_read_misses"
+    };
+
+    std::printf("{\n  \"counters\": %s,\n  \"kernels\": [\n", perf.any() ? "true" : "false");
+    for (size_t k=0; k < results.size(); ++k)
+    {
+        const Result& r = results[k];
+        std::printf("    { \"name\": \"%s\", \"ns\": %.4f", r.name, r.ns);
+        for (int i=0; i < PerfCounters::kCount; ++i)
+            if (perf.has((PerfCounters::Counter)i))
+                std::printf(", \"%s\": %.4f", names[i], r.counters[i]);
+        if (perf.has(PerfCounters::kCycles) && perf.has(PerfCounters::kInstructions)
+            && r.counters[PerfCounters::kCycles] > 0.0)
+            std::printf(", \"ipc\": %.3f", r.counters[PerfCounters::kInstructions]
+                                           / r.counters[PerfCounters::kCycles]);
+        std::printf(" }%s\n", k+1 < results.size() ? "," : "");
+    }
+    std::printf("  ]\n}\n");
+}
+
+// -----------------------------------------------------------------------
+// Layout
+
+struct Layout
+{
+    const char* name;
+    size_t bytes;
+    size_t align;
+    // Byte ranges touched every sample and every pre filter block, empty
+    // when unknown
+    size_t sampleBegin, sampleEnd;
+    size_t blockBegin, blockEnd;
+};
+
+/*
+ * Cache lines the ranges cover, at the worst offset from a line the
+ * alignment lets the object start at. Both ranges together for the block.
+ */
+static uint32_t linesTouched(const Layout& l, bool block)
+{
+    const size_t step = std::min<size_t>(l.align, 64);
+    uint32_t worst = 0;
+    for (size_t base=0; base < 64; base += step)
+    {
+        uint64_t lines = 0;
+        const auto mark = [&](size_t begin, size_t end) {
+            for (size_t line=(base+begin)/64; begin < end && line <= (base+end-1)/64; ++line)
+                lines |= uint64_t(1) << line;
+        };
+        mark(l.sampleBegin, l.sampleEnd);
+        if (block)
+            mark(l.blockBegin, l.blockEnd);
+        worst = std::max(worst, (uint32_t)__builtin_popcountll(lines));
+    }
+    return worst;
+}
+
+static std::vector<Layout> getLayouts()
+{
+    const HexedProbe hexed;
+    const MoogProbe  moog;
+    std::vector<Layout> layouts = {
+        { "RobotHexedFilterDSP", sizeof(RobotHexedFilterDSP), alignof(RobotHexedFilterDSP),
+          hexed.sampleBegin(), hexed.sampleEnd(), hexed.blockBegin(), hexed.blockEnd() },
+        { "RobotMoogFilterDSP", sizeof(RobotMoogFilterDSP), alignof(RobotMoogFilterDSP),
+          moog.sampleBegin(), moog.sampleEnd(), 0, 0 },
+        { "Hexed farm, per stream", sizeof(RobotHexedFilterFarm::Lanes) / RobotHexedFilterFarm::kLanes,
+          alignof(RobotHexedFilterFarm::Lanes), 0, 0, 0, 0 },
+        { "RobotHexedVoiceBank", sizeof(RobotHexedVoiceBank), alignof(RobotHexedVoiceBank), 0, 0, 0, 0 },
+        { "RobotBufferPlayer", sizeof(RobotBufferPlayer), alignof(RobotBufferPlayer), 0, 0, 0, 0 },
+        { "RobotWet", sizeof(RobotWet), alignof(RobotWet), 0, 0, 0, 0 },
+        { "LPFSmooth", sizeof(LPFSmooth), alignof(LPFSmooth), 0, 0, 0, 0 },
+        { "LISmooth", sizeof(LISmooth), alignof(LISmooth), 0, 0, 0, 0 },
+#ifdef ROBOT_BENCH_PLUGINS
+        { "RobotHexedFilterPlugin", sizeof(DISTRHO::RobotHexedFilterPlugin),
+          alignof(DISTRHO::RobotHexedFilterPlugin), 0, 0, 0, 0 },
+        { "RobotMoogFilterPlugin", sizeof(DISTRHO::RobotMoogFilterPlugin),
+          alignof(DISTRHO::RobotMoogFilterPlugin), 0, 0, 0, 0 },
+#endif
+    };
+    return layouts;
+}
+
+static void printLayoutTable(const std::vector<Layout>& layouts)
+{
+    std::printf("%-24s %7s %11s %12s %11s\n", "class", "bytes", "per sample", "lines/sample", "lines/block");
+    for (const Layout& l : layouts)
+    {
+        std::printf("%-24s %7zu", l.name, l.bytes);
+        if (l.sampleEnd > l.sampleBegin)
+            std::printf(" %11zu %12u %11u\n", l.sampleEnd - l.sampleBegin,
+                        linesTouched(l, false), linesTouched(l, true));
+        else
+            std::printf(" %11s %12s %11s\n", "-", "-", "-");
+    }
+#ifndef ROBOT_BENCH_PLUGINS
+    std::printf("\nNo DPF headers, plugin sizes need the dpf submodule\n");
+#endif
+}
+
+static void printLayoutJson(const std::vector<Layout>& layouts)
+{
+    std::printf("{\n  \"layout\": [\n");
+    for (size_t k=0; k < layouts.size(); ++k)
+    {
+        const Layout& l = layouts[k];
+        std::printf("    { \"name\": \"%s\", \"bytes\": %zu", l.name, l.bytes);
+        if (l.sampleEnd > l.sampleBegin)
+            std::printf(", \"per_sample_bytes\": %zu, \"lines_per_sample\": %u, \"lines_per_block\": %u",
+                        l.sampleEnd - l.sampleBegin, linesTouched(l, false), linesTouched(l, true));
+        std::printf(" }%s\n", k+1 < layouts.size() ? "," : "");
+    }
+    std::printf("  ]\n}\n");
+}
+
+// -----------------------------------------------------------------------
+// Farm check
+
+/*
+ * Streams through the farm and each through its own RobotHexedFilterDSP.
+ * The farm runs fastAtan where the scalar filter runs atan, the worst
+ * difference over all streams has to stay below kFarmTolerance dB of the
+ * peak, about 20 dB above what it is. On the pool the output has to be
+ * the same to the bit. A stream count and a length that are not whole
+ * lanes or blocks cover the ragged ends.
+ */
+static const float kFarmTolerance = -100.0f;
+
+static bool checkFarm(uint32_t streams, float mode)
+{
+    const uint32_t frames = 4800 + 37;
+    std::vector<float> in(streams*frames), ref(streams*frames);
+    std::vector<float> out(streams*frames), outPool(streams*frames);
+    std::vector<const float*> ins(streams);
+    std::vector<float*> outs(streams), outsPool(streams);
+
+    RobotHexedFilterFarm farm(48000.0, streams), farmPool(48000.0, streams);
+    farmPool.setTaskPool(&getPool());
+    farm.setMode(mode);
+    farmPool.setMode(mode);
+
+    uint32_t seed = 7;
+    for (uint32_t s=0; s < streams; ++s)
+    {
+        const float cutoff    = 0.2f + 0.6f*(s % 11)/10.0f;
+        const float resonance = 0.1f + 0.8f*(s % 7)/6.0f;
+        float* x = &in[s*frames];
+        for (uint32_t i=0; i < frames; ++i)
+        {
+            seed = seed*1664525u + 1013904223u;
+            x[i] = 0.4f*sinf(i*(0.01f + 0.001f*(s % 17)))
+                 + 0.1f*((float)(seed >> 8) * (2.0f/16777216.0f) - 1.0f);
+        }
+        ins[s]      = x;
+        outs[s]     = &out[s*frames];
+        outsPool[s] = &outPool[s*frames];
+        farm.setCutOff(s, cutoff);
+        farm.setResonance(s, resonance);
+        farmPool.setCutOff(s, cutoff);
+        farmPool.setResonance(s, resonance);
+
+        // flush() clears the mode and resonance, they come after it
+        RobotHexedFilterDSP dsp(48000.0);
+        dsp.flush(48000.0);
+        dsp.setCutOff(cutoff);
+        dsp.setResonance(resonance);
+        dsp.setMode(mode);
+        dsp.process(x, &ref[s*frames], frames);
+    }
+    farm.process(ins.data(), outs.data(), frames);
+    farmPool.process(ins.data(), outsPool.data(), frames);
+
+    float peak = 0.0f, error = 0.0f;
+    for (size_t i=0; i < ref.size(); ++i)
+    {
+        peak  = std::max(peak, fabsf(ref[i]));
+        error = std::max(error, fabsf(out[i] - ref[i]));
+    }
+    const float db   = error > 0.0f ? 20.0f*log10f(error/peak) : -999.0f;
+    const bool  same = std::memcmp(out.data(), outPool.data(), sizeof(float)*out.size()) == 0;
+    const bool  ok   = peak > 0.0f && db < kFarmTolerance && same;
+    std::printf("%-6s %3u streams, mode %.1f, worst %7.1f dB of peak, pool %s\n",
+                ok ? "ok" : "FAILED", streams, mode, db, same ? "the same" : "DIFFERS");
+    return ok;
+}
+
+static bool checkFarm()
+{
+    bool ok = true;
+    for (uint32_t streams : { 1u, 37u, 64u })
+        for (float mode : { 4.0f, 1.0f, 2.5f })
+            ok &= checkFarm(streams, mode);
+    return ok;
+}
+
+int main(int argc, char* argv[])
+{
+    bool json = false;
+    bool layout = false;
+    bool check = false;
+    uint32_t calls = 1 << 22;
+    std::vector<std::string> only;
+
+    for (int i=1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--json") == 0)
+            json = true;
+        else if (std::strcmp(argv[i], "--calls") == 0 && i+1 < argc)
+            calls = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--layout") == 0)
+            layout = true;
+        else if (std::strcmp(argv[i], "--check") == 0)
+            check = true;
+        else if (argv[i][0] == '-')
+        {
+            std::fprintf(stderr, "usage: %s [--json] [--calls N] [--layout] [--check] [kernel ...]\n", argv[0]);
+            return 1;
+        }
+        else
+            only.push_back(argv[i]);
+    }
+
+    if (check)
+        return checkFarm() ? 0 : 1;
+
+    if (layout)
+    {
+        if (json)
+            printLayoutJson(getLayouts());
+        else
+            printLayoutTable(getLayouts());
+        return 0;
+    }
+
+    // Audio like input in +-1, 16 KB so it stays in L1
+    std::vector<float> in(4096);
+    uint32_t seed = 1;
+    for (float& x : in)
+    {
+        seed = seed*1664525u + 1013904223u;
+        x = (float)(seed >> 8) * (2.0f/16777216.0f) - 1.0f;
+    }
+
+    PerfCounters perf;
+    std::vector<Result> results;
+    for (const Kernel& kernel : kernels)
+    {
+        bool wanted = only.empty();
+        for (const std::string& name : only)
+            wanted |= name == kernel.name;
+        if (wanted)
+            results.push_back(measure(kernel, perf, in, calls));
+    }
+
+    if (json)
+        printJson(results, perf);
+    else
+        printTable(results, perf);
+    return 0;
+}
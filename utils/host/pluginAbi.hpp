@@ -0,0 +1,378 @@
+/*
+ *  Robot Audio Plugins
+ *  Copyright (C) 2023  Martin Bångens
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <cstdint>
+/*
+ * The parts of the LADSPA, LV2, CLAP and VST2 binary interfaces robot-host
+ * calls, laid out like the SDK headers so the host builds without them.
+ * Structs the plugin hands out stop after the last member the host reads,
+ * VST3 is in vst3Abi.hpp.
+ */
+
+// -----------------------------------------------------------------------
+// LADSPA
+
+namespace ladspa {
+
+enum
+{
+    kPortInput   = 0x1,
+    kPortOutput  = 0x2,
+    kPortControl = 0x4,
+    kPortAudio   = 0x8
+};
+
+enum
+{
+    kHintBoundedBelow = 0x1,
+    kHintBoundedAbove = 0x2,
+    kHintSampleRate   = 0x8,
+    kHintLogarithmic  = 0x10,
+
+    kHintDefaultMask    = 0x3C0,
+    kHintDefaultLow     = 0x80,
+    kHintDefaultMiddle  = 0xC0,
+    kHintDefaultHigh    = 0x100,
+    kHintDefaultMaximum = 0x140,
+    kHintDefault0       = 0x200,
+    kHintDefault1       = 0x240,
+    kHintDefault100     = 0x280,
+    kHintDefault440     = 0x2C0
+};
+
+struct PortRangeHint
+{
+    int   hints;
+    float lower;
+    float upper;
+};
+
+struct Descriptor
+{
+    unsigned long  uniqueId;
+    const char*    label;
+    int            properties;
+    const char*    name;
+    const char*    maker;
+    const char*    copyright;
+    unsigned long  portCount;
+    const int*     portDescriptors;
+    const char* const*   portNames;
+    const PortRangeHint* portRangeHints;
+    void*          implementationData;
+    void* (*instantiate)(const Descriptor*, unsigned long sampleRate);
+    void  (*connectPort)(void* instance, unsigned long port, float* data);
+    void  (*activate)(void* instance);
+    void  (*run)(void* instance, unsigned long frames);
+    void  (*runAdding)(void* instance, unsigned long frames);
+    void  (*setRunAddingGain)(void* instance, float gain);
+    void  (*deactivate)(void* instance);
+    void  (*cleanup)(void* instance);
+};
+
+typedef const Descriptor* (*DescriptorFunction)(unsigned long index);
+
+} // namespace ladspa
+
+// -----------------------------------------------------------------------
+// LV2
+
+namespace lv2 {
+
+struct Feature
+{
+    const char* uri;
+    void*       data;
+};
+
+struct Descriptor
+{
+    const char* uri;
+    void* (*instantiate)(const Descriptor*, double sampleRate, const char* bundlePath,
+                         const Feature* const* features);
+    void  (*connectPort)(void* instance, uint32_t port, void* data);
+    void  (*activate)(void* instance);
+    void  (*run)(void* instance, uint32_t frames);
+    void  (*deactivate)(void* instance);
+    void  (*cleanup)(void* instance);
+    const void* (*extensionData)(const char* uri);
+};
+
+typedef const Descriptor* (*DescriptorFunction)(uint32_t index);
+
+struct UridMap
+{
+    void*    handle;
+    uint32_t (*map)(void* handle, const char* uri);
+};
+
+struct Option
+{
+    uint32_t    context;
+    uint32_t    subject;
+    uint32_t    key;
+    uint32_t    size;
+    uint32_t    type;
+    const void* value;
+};
+
+struct AtomSequence
+{
+    uint32_t size;
+    uint32_t type;
+    uint32_t unit;
+    uint32_t pad;
+};
+
+struct ProgramDescriptor
+{
+    uint32_t    bank;
+    uint32_t    program;
+    const char* name;
+};
+
+struct ProgramsInterface
+{
+    const ProgramDescriptor* (*getProgram)(void* instance, uint32_t index);
+    void (*selectProgram)(void* instance, uint32_t bank, uint32_t program);
+};
+
+} // namespace lv2
+
+// -----------------------------------------------------------------------
+// CLAP
+
+namespace clap {
+
+struct Version
+{
+    uint32_t major, minor, revision;
+};
+
+struct PluginDescriptor
+{
+    Version     version;
+    const char* id;
+    const char* name;
+    const char* vendor;
+    const char* url;
+    const char* manualUrl;
+    const char* supportUrl;
+    const char* versionString;
+    const char* description;
+    const char* const* features;
+};
+
+struct Host
+{
+    Version     version;
+    void*       hostData;
+    const char* name;
+    const char* vendor;
+    const char* url;
+    const char* versionString;
+    const void* (*getExtension)(const Host*, const char* id);
+    void (*requestRestart)(const Host*);
+    void (*requestProcess)(const Host*);
+    void (*requestCallback)(const Host*);
+};
+
+struct EventHeader
+{
+    uint32_t size;
+    uint32_t time;
+    uint16_t spaceId;
+    uint16_t type;
+    uint32_t flags;
+};
+
+enum
+{
+    kEventParamValue = 5
+};
+
+struct EventParamValue
+{
+    EventHeader header;
+    uint32_t    paramId;
+    void*       cookie;
+    int32_t     noteId;
+    int16_t     portIndex;
+    int16_t     channel;
+    int16_t     key;
+    double      value;
+};
+
+struct InputEvents
+{
+    void* ctx;
+    uint32_t (*size)(const InputEvents*);
+    const EventHeader* (*get)(const InputEvents*, uint32_t index);
+};
+
+struct OutputEvents
+{
+    void* ctx;
+    bool (*tryPush)(const OutputEvents*, const EventHeader*);
+};
+
+struct AudioBuffer
+{
+    float**  data32;
+    double** data64;
+    uint32_t channelCount;
+    uint32_t latency;
+    uint64_t constantMask;
+};
+
+struct Process
+{
+    int64_t            steadyTime;
+    uint32_t           framesCount;
+    const void*        transport;
+    const AudioBuffer* audioInputs;
+    AudioBuffer*       audioOutputs;
+    uint32_t           audioInputsCount;
+    uint32_t           audioOutputsCount;
+    const InputEvents*  inEvents;
+    const OutputEvents* outEvents;
+};
+
+struct Plugin
+{
+    const PluginDescriptor* desc;
+    void* pluginData;
+    bool  (*init)(const Plugin*);
+    void  (*destroy)(const Plugin*);
+    bool  (*activate)(const Plugin*, double sampleRate, uint32_t minFrames, uint32_t maxFrames);
+    void  (*deactivate)(const Plugin*);
+    bool  (*startProcessing)(const Plugin*);
+    void  (*stopProcessing)(const Plugin*);
+    void  (*reset)(const Plugin*);
+    int32_t (*process)(const Plugin*, const Process*);
+    const void* (*getExtension)(const Plugin*, const char* id);
+    void  (*onMainThread)(const Plugin*);
+};
+
+struct PluginFactory
+{
+    uint32_t (*getPluginCount)(const PluginFactory*);
+    const PluginDescriptor* (*getPluginDescriptor)(const PluginFactory*, uint32_t index);
+    const Plugin* (*createPlugin)(const PluginFactory*, const Host*, const char* pluginId);
+};
+
+struct PluginEntry
+{
+    Version     version;
+    bool        (*init)(const char* path);
+    void        (*deinit)();
+    const void* (*getFactory)(const char* id);
+};
+
+struct ParamInfo
+{
+    uint32_t id;
+    uint32_t flags;
+    void*    cookie;
+    char     name[256];
+    char     module[1024];
+    double   minValue;
+    double   maxValue;
+    double   defaultValue;
+};
+
+struct PluginParams
+{
+    uint32_t (*count)(const Plugin*);
+    bool     (*getInfo)(const Plugin*, uint32_t index, ParamInfo* info);
+};
+
+struct AudioPortInfo
+{
+    uint32_t    id;
+    char        name[256];
+    uint32_t    flags;
+    uint32_t    channelCount;
+    const char* portType;
+    uint32_t    inPlacePair;
+};
+
+struct PluginAudioPorts
+{
+    uint32_t (*count)(const Plugin*, bool isInput);
+    bool     (*get)(const Plugin*, uint32_t index, bool isInput, AudioPortInfo* info);
+};
+
+} // namespace clap
+
+// -----------------------------------------------------------------------
+// VST2
+
+namespace vst2 {
+
+struct Effect;
+
+typedef intptr_t (*HostCallback)(Effect*, int32_t opcode, int32_t index, intptr_t value,
+                                 void* ptr, float opt);
+
+enum
+{
+    kMagic = 0x56737450, // 'VstP'
+
+    kEffOpen = 0,
+    kEffClose = 1,
+    kEffSetProgram = 2,
+    kEffGetParamName = 8,
+    kEffSetSampleRate = 10,
+    kEffSetBlockSize = 11,
+    kEffMainsChanged = 12,
+
+    kMasterVersion = 1
+};
+
+struct Effect
+{
+    int32_t  magic;
+    intptr_t (*dispatcher)(Effect*, int32_t opcode, int32_t index, intptr_t value,
+                           void* ptr, float opt);
+    void     (*process)(Effect*, float** in, float** out, int32_t frames);
+    void     (*setParameter)(Effect*, int32_t index, float value);
+    float    (*getParameter)(Effect*, int32_t index);
+    int32_t  numPrograms;
+    int32_t  numParams;
+    int32_t  numInputs;
+    int32_t  numOutputs;
+    int32_t  flags;
+    intptr_t reserved1;
+    intptr_t reserved2;
+    int32_t  initialDelay;
+    int32_t  realQualities;
+    int32_t  offQualities;
+    float    ioRatio;
+    void*    object;
+    void*    user;
+    int32_t  uniqueId;
+    int32_t  version;
+    void     (*processReplacing)(Effect*, float** in, float** out, int32_t frames);
+    void     (*processDoubleReplacing)(Effect*, double** in, double** out, int32_t frames);
+    char     future[56];
+};
+
+typedef Effect* (*MainFunction)(HostCallback);
+
+} // namespace vst2
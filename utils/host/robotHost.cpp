@@ -0,0 +1,1665 @@
+/*
+ *  Robot Audio Plugins
+ *  Copyright (C) 2023  Martin Bångens
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Cost of each plugin format
+ *
+ * A minimal host that dlopens every binary make put in bin/, one plugin and
+ * format at a time, and times the process call over blocks of noise with a
+ * CutOff change in every block and Wet all the way up. The "dsp" rows run
+ * the filter classes straight, the gap to them is what run() and the format
+ * wrapper add per block. run() is the same code in every format, so the
+ * differences between the formats are the wrappers' own. Poly gets no
+ * notes and has no dsp row. Numbers are best of a few runs.
+ *
+ * --lifecycle times what a host scanning or loading a project waits on
+ * instead: instantiate, the first activate, deactivate and activating again
+ * at the same rate, best of a few fresh instances.
+ *
+ * --rt-check times nothing and drives every plugin through run(), every
+ * parameter over its range, the programs, a NaN and a sleep and wake with
+ * rtCheck.hpp watching, it fails if any of it allocates, locks or makes a
+ * blocking system call.
+ *
+ *     robot-host [--bin DIR] [--json] [--frames N] [--blocks N] [--lifecycle | --rt-check]
+ *                [plugin ...]
+ */
+
+#include <chrono>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <dlfcn.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+
+#include "pluginAbi.hpp"
+#include "rtCheck.hpp"
+#include "vst3Abi.hpp"
+#include "alignedNew.hpp"
+#include "RobotHexedFilterDSP.hpp"
+#include "RobotMoogFilterDSP.hpp"
+
+static const uint32_t kMaxFrames = 4096;
+
+// -----------------------------------------------------------------------
+// Instances
+
+/*
+ * One plugin in one format. The host owns the audio buffers, inputs hold
+ * the test signal and every port or channel gets its own buffer.
+ */
+class Instance
+{
+public:
+    struct Param
+    {
+        std::string name;
+        float min, max;
+    };
+
+    virtual ~Instance()
+    {
+        if (library != nullptr)
+            dlclose(library);
+    }
+
+    // Index of the parameter called name, -1 if there is none
+    int findParam(const char* name) const
+    {
+        for (size_t i=0; i < params.size(); ++i)
+            if (params[i].name == name)
+                return (int)i;
+        return -1;
+    }
+
+    // 0-1 over the parameter's range, the plugin sees it at the next process()
+    virtual void setParam(uint32_t index, float normalized) = 0;
+    virtual void process(uint32_t frames) = 0;
+
+    // Instances come from a LoadFunction inactive, the host side of activate
+    // and deactivate in the format
+    virtual bool activate(double) { return true; }
+    virtual void deactivate() {}
+
+    // Formats with programs, the plugin loads one at once or in the next process()
+    virtual uint32_t getProgramCount() const { return 0; }
+    virtual void selectProgram(uint32_t) {}
+
+    std::vector<Param> params;
+    std::vector<std::vector<float>> inputs, outputs;
+
+protected:
+    explicit Instance(void* lib) : library(lib) {}
+
+    void setChannels(uint32_t ins, uint32_t outs)
+    {
+        inputs.assign(ins, std::vector<float>(kMaxFrames, 0.0f));
+        outputs.assign(outs, std::vector<float>(kMaxFrames, 0.0f));
+    }
+
+    float plain(uint32_t index, float normalized) const
+    {
+        return params[index].min + normalized * (params[index].max - params[index].min);
+    }
+
+private:
+    // Closed after the format's destructor has torn the plugin down
+    void* library;
+};
+
+typedef Instance* (*LoadFunction)(void* library, const std::string& path, double sampleRate,
+                                  std::string& error);
+
+// -----------------------------------------------------------------------
+// LADSPA
+
+class LadspaInstance : public Instance
+{
+public:
+    LadspaInstance(void* lib, const ladspa::Descriptor* desc) : Instance(lib), desc(desc) {}
+
+    ~LadspaInstance()
+    {
+        if (handle == nullptr)
+            return;
+        deactivate();
+        desc->cleanup(handle);
+    }
+
+    bool init(double sampleRate, std::string& error)
+    {
+        handle = desc->instantiate(desc, (unsigned long)sampleRate);
+        if (handle == nullptr)
+        {
+            error = "instantiate failed";
+            return false;
+        }
+
+        uint32_t ins = 0, outs = 0;
+        for (unsigned long p=0; p < desc->portCount; ++p)
+            if (desc->portDescriptors[p] & ladspa::kPortAudio)
+                ++(desc->portDescriptors[p] & ladspa::kPortInput ? ins : outs);
+        setChannels(ins, outs);
+
+        controls.assign(desc->portCount, 0.0f);
+        ins = outs = 0;
+        for (unsigned long p=0; p < desc->portCount; ++p)
+        {
+            const int port = desc->portDescriptors[p];
+            if (port & ladspa::kPortAudio)
+            {
+                std::vector<float>& buffer = port & ladspa::kPortInput ? inputs[ins++] : outputs[outs++];
+                desc->connectPort(handle, p, buffer.data());
+                continue;
+            }
+
+            const ladspa::PortRangeHint& hint = desc->portRangeHints[p];
+            const float scale = hint.hints & ladspa::kHintSampleRate ? (float)sampleRate : 1.0f;
+            const float min = hint.hints & ladspa::kHintBoundedBelow ? hint.lower*scale : 0.0f;
+            const float max = hint.hints & ladspa::kHintBoundedAbove ? hint.upper*scale : 1.0f;
+            controls[p] = defaultValue(hint.hints, min, max);
+            desc->connectPort(handle, p, &controls[p]);
+
+            if (port & ladspa::kPortInput)
+            {
+                params.push_back({ desc->portNames[p], min, max });
+                paramPorts.push_back(p);
+            }
+        }
+        return true;
+    }
+
+    // The rate is the one from instantiate
+    bool activate(double) override
+    {
+        if (desc->activate != nullptr)
+            desc->activate(handle);
+        active = true;
+        return true;
+    }
+
+    void deactivate() override
+    {
+        if (active && desc->deactivate != nullptr)
+            desc->deactivate(handle);
+        active = false;
+    }
+
+    void setParam(uint32_t index, float normalized) override
+    {
+        controls[paramPorts[index]] = plain(index, normalized);
+    }
+
+    void process(uint32_t frames) override
+    {
+        desc->run(handle, frames);
+    }
+
+    static Instance* load(void* lib, const std::string&, double sampleRate, std::string& error)
+    {
+        const ladspa::DescriptorFunction function
+            = (ladspa::DescriptorFunction)dlsym(lib, "ladspa_descriptor");
+        const ladspa::Descriptor* const desc = function != nullptr ? function(0) : nullptr;
+        if (desc == nullptr)
+        {
+            error = "no ladspa_descriptor";
+            return nullptr;
+        }
+
+        LadspaInstance* const instance = new LadspaInstance(lib, desc);
+        if (!instance->init(sampleRate, error))
+        {
+            delete instance;
+            return nullptr;
+        }
+        return instance;
+    }
+
+private:
+    // The default hint of the port, lower bound if it has none
+    static float defaultValue(int hints, float min, float max)
+    {
+        const bool log = (hints & ladspa::kHintLogarithmic) && min > 0.0f;
+        const auto between = [&](float amount) {
+            return log ? std::exp(std::log(min)*(1.0f-amount) + std::log(max)*amount)
+                       : min*(1.0f-amount) + max*amount;
+        };
+
+        switch (hints & ladspa::kHintDefaultMask)
+        {
+        case ladspa::kHintDefaultLow:     return between(0.25f);
+        case ladspa::kHintDefaultMiddle:  return between(0.5f);
+        case ladspa::kHintDefaultHigh:    return between(0.75f);
+        case ladspa::kHintDefaultMaximum: return max;
+        case ladspa::kHintDefault0:       return 0.0f;
+        case ladspa::kHintDefault1:       return 1.0f;
+        case ladspa::kHintDefault100:     return 100.0f;
+        case ladspa::kHintDefault440:     return 440.0f;
+        default:                          return min;
+        }
+    }
+
+    const ladspa::Descriptor* desc;
+    void* handle = nullptr;
+    bool  active = false;
+    std::vector<float> controls;
+    std::vector<unsigned long> paramPorts;
+};
+
+// -----------------------------------------------------------------------
+// LV2
+
+/*
+ * Ports come from the plugin's turtle, read with a scanner that only knows
+ * the layout DPF's ttl generator writes: one [ ... ] block per port.
+ */
+struct Lv2Port
+{
+    uint32_t    index = 0;
+    bool        input = false;
+    bool        audio = false;
+    bool        atom  = false;
+    std::string name;
+    float       def = 0.0f, min = 0.0f, max = 1.0f;
+};
+
+static std::string readFile(const std::string& path)
+{
+    std::string text;
+    if (FILE* const file = std::fopen(path.c_str(), "rb"))
+    {
+        char chunk[4096];
+        size_t got;
+        while ((got = std::fread(chunk, 1, sizeof(chunk), file)) > 0)
+            text.append(chunk, got);
+        std::fclose(file);
+    }
+    return text;
+}
+
+// The token after key in block, empty if key is not there
+static std::string ttlValue(const std::string& block, const char* key)
+{
+    size_t at = block.find(key);
+    if (at == std::string::npos)
+        return std::string();
+    at += std::strlen(key);
+    while (at < block.size() && std::isspace((unsigned char)block[at]))
+        ++at;
+    if (at < block.size() && block[at] == '"')
+        return block.substr(at+1, block.find('"', at+1) - at - 1);
+    size_t end = at;
+    while (end < block.size() && !std::isspace((unsigned char)block[end]) && block[end] != ';')
+        ++end;
+    return block.substr(at, end - at);
+}
+
+static void parseTtlPorts(const std::string& text, std::vector<Lv2Port>& ports)
+{
+    std::vector<size_t> open;
+    for (size_t i=0; i < text.size(); ++i)
+    {
+        if (text[i] == '[')
+        {
+            open.push_back(i);
+            continue;
+        }
+        if (text[i] != ']' || open.empty())
+            continue;
+
+        // Unit blocks nest inside ports, they have no index
+        const std::string block = text.substr(open.back(), i - open.back());
+        open.pop_back();
+        if (block.find("lv2:index") == std::string::npos)
+            continue;
+
+        Lv2Port port;
+        port.index = (uint32_t)std::strtoul(ttlValue(block, "lv2:index").c_str(), nullptr, 10);
+        port.input = block.find("lv2:InputPort") != std::string::npos;
+        port.audio = block.find("lv2:AudioPort") != std::string::npos
+                  || block.find("lv2:CVPort") != std::string::npos;
+        port.atom  = block.find("atom:AtomPort") != std::string::npos;
+        port.name  = ttlValue(block, "lv2:name");
+        port.def   = std::strtof(ttlValue(block, "lv2:default").c_str(), nullptr);
+        port.min   = std::strtof(ttlValue(block, "lv2:minimum").c_str(), nullptr);
+        port.max   = std::strtof(ttlValue(block, "lv2:maximum").c_str(), nullptr);
+        ports.push_back(port);
+    }
+}
+
+class Lv2Instance : public Instance
+{
+public:
+    Lv2Instance(void* lib, const lv2::Descriptor* desc) : Instance(lib), desc(desc) {}
+
+    ~Lv2Instance()
+    {
+        if (handle == nullptr)
+            return;
+        deactivate();
+        desc->cleanup(handle);
+    }
+
+    bool init(const std::string& bundle, double sampleRate, std::string& error)
+    {
+        std::vector<Lv2Port> ports;
+        if (DIR* const dir = opendir(bundle.c_str()))
+        {
+            while (const dirent* const entry = readdir(dir))
+            {
+                const std::string name = entry->d_name;
+                if (name.size() > 4 && name.compare(name.size()-4, 4, ".ttl") == 0)
+                    parseTtlPorts(readFile(bundle + name), ports);
+            }
+            closedir(dir);
+        }
+        if (ports.empty())
+        {
+            error = "no ports in " + bundle;
+            return false;
+        }
+
+        uridMap.handle = this;
+        uridMap.map    = mapUri;
+        maxBlock  = kMaxFrames;
+        rate      = (float)sampleRate;
+        sequenceUrid = mapUri(this, "http://lv2plug.in/ns/ext/atom#Sequence");
+        chunkUrid    = mapUri(this, "http://lv2plug.in/ns/ext/atom#Chunk");
+        const uint32_t intUrid   = mapUri(this, "http://lv2plug.in/ns/ext/atom#Int");
+        const uint32_t floatUrid = mapUri(this, "http://lv2plug.in/ns/ext/atom#Float");
+        options[0] = { 0, 0, mapUri(this, "http://lv2plug.in/ns/ext/buf-size#maxBlockLength"),
+                       sizeof(int32_t), intUrid, &maxBlock };
+        options[1] = { 0, 0, mapUri(this, "http://lv2plug.in/ns/ext/buf-size#nominalBlockLength"),
+                       sizeof(int32_t), intUrid, &maxBlock };
+        options[2] = { 0, 0, mapUri(this, "http://lv2plug.in/ns/ext/parameters#sampleRate"),
+                       sizeof(float), floatUrid, &rate };
+        options[3] = { 0, 0, 0, 0, 0, nullptr };
+
+        const lv2::Feature mapFeature     = { "http://lv2plug.in/ns/ext/urid#map", &uridMap };
+        const lv2::Feature optionsFeature = { "http://lv2plug.in/ns/ext/options#options", options };
+        const lv2::Feature boundedFeature = { "http://lv2plug.in/ns/ext/buf-size#boundedBlockLength", nullptr };
+        const lv2::Feature* const features[] = { &mapFeature, &optionsFeature, &boundedFeature, nullptr };
+
+        const std::string path = bundle;
+        handle = desc->instantiate(desc, sampleRate, path.c_str(), features);
+        if (handle == nullptr)
+        {
+            error = "instantiate failed";
+            return false;
+        }
+
+        uint32_t ins = 0, outs = 0;
+        for (const Lv2Port& port : ports)
+            if (port.audio)
+                ++(port.input ? ins : outs);
+        setChannels(ins, outs);
+
+        controls.assign(ports.size(), 0.0f);
+        atoms.assign(ports.size(), std::vector<uint64_t>());
+        ins = outs = 0;
+        for (const Lv2Port& port : ports)
+        {
+            const uint32_t i = port.index;
+            if (i >= ports.size())
+                continue;
+            if (port.audio)
+            {
+                std::vector<float>& buffer = port.input ? inputs[ins++] : outputs[outs++];
+                desc->connectPort(handle, i, buffer.data());
+            }
+            else if (port.atom)
+            {
+                atoms[i].assign(kAtomCapacity / sizeof(uint64_t), 0);
+                (port.input ? atomIns : atomOuts).push_back((lv2::AtomSequence*)atoms[i].data());
+                desc->connectPort(handle, i, atoms[i].data());
+            }
+            else
+            {
+                controls[i] = port.def;
+                desc->connectPort(handle, i, &controls[i]);
+                if (port.input)
+                {
+                    params.push_back({ port.name, port.min, port.max });
+                    paramPorts.push_back(i);
+                }
+            }
+        }
+
+        if (desc->extensionData != nullptr)
+            programs = (const lv2::ProgramsInterface*)desc->extensionData(
+                "http://lv2plug.in/ns/ext/programs#Interface");
+        while (programs != nullptr)
+        {
+            const lv2::ProgramDescriptor* const program
+                = programs->getProgram(handle, (uint32_t)programList.size());
+            if (program == nullptr)
+                break;
+            programList.push_back({ program->bank, program->program, nullptr });
+        }
+        return true;
+    }
+
+    // The rate is the one from instantiate
+    bool activate(double) override
+    {
+        if (desc->activate != nullptr)
+            desc->activate(handle);
+        active = true;
+        return true;
+    }
+
+    void deactivate() override
+    {
+        if (active && desc->deactivate != nullptr)
+            desc->deactivate(handle);
+        active = false;
+    }
+
+    void setParam(uint32_t index, float normalized) override
+    {
+        controls[paramPorts[index]] = plain(index, normalized);
+    }
+
+    uint32_t getProgramCount() const override
+    {
+        return (uint32_t)programList.size();
+    }
+
+    void selectProgram(uint32_t index) override
+    {
+        programs->selectProgram(handle, programList[index].bank, programList[index].program);
+    }
+
+    void process(uint32_t frames) override
+    {
+        // Empty event input, room for the plugin to write its output
+        for (lv2::AtomSequence* sequence : atomIns)
+        {
+            sequence->size = sizeof(uint32_t)*2;
+            sequence->type = sequenceUrid;
+        }
+        for (lv2::AtomSequence* sequence : atomOuts)
+        {
+            sequence->size = kAtomCapacity - sizeof(uint32_t)*2;
+            sequence->type = chunkUrid;
+        }
+        desc->run(handle, frames);
+    }
+
+    static Instance* load(void* lib, const std::string& path, double sampleRate, std::string& error)
+    {
+        const lv2::DescriptorFunction function = (lv2::DescriptorFunction)dlsym(lib, "lv2_descriptor");
+        const lv2::Descriptor* const desc = function != nullptr ? function(0) : nullptr;
+        if (desc == nullptr)
+        {
+            error = "no lv2_descriptor";
+            return nullptr;
+        }
+
+        Lv2Instance* const instance = new Lv2Instance(lib, desc);
+        if (!instance->init(path.substr(0, path.rfind('/')+1), sampleRate, error))
+        {
+            delete instance;
+            return nullptr;
+        }
+        return instance;
+    }
+
+private:
+    static const uint32_t kAtomCapacity = 8192;
+
+    static uint32_t mapUri(void* handle, const char* uri)
+    {
+        std::vector<std::string>& uris = ((Lv2Instance*)handle)->uris;
+        for (size_t i=0; i < uris.size(); ++i)
+            if (uris[i] == uri)
+                return (uint32_t)i + 1;
+        uris.push_back(uri);
+        return (uint32_t)uris.size();
+    }
+
+    const lv2::Descriptor* desc;
+    void* handle = nullptr;
+    bool  active = false;
+    std::vector<float> controls;
+    std::vector<uint32_t> paramPorts;
+    std::vector<std::vector<uint64_t>> atoms;
+    std::vector<lv2::AtomSequence*> atomIns, atomOuts;
+    const lv2::ProgramsInterface* programs = nullptr;
+    std::vector<lv2::ProgramDescriptor> programList;
+
+    // Features, alive as long as the plugin
+    std::vector<std::string> uris;
+    lv2::UridMap uridMap;
+    lv2::Option  options[4];
+    int32_t  maxBlock;
+    float    rate;
+    uint32_t sequenceUrid, chunkUrid;
+};
+
+// -----------------------------------------------------------------------
+// CLAP
+
+class ClapInstance : public Instance
+{
+public:
+    ClapInstance(void* lib, const clap::PluginEntry* entry) : Instance(lib), entry(entry)
+    {
+        host.version       = { 1, 0, 0 };
+        host.hostData      = this;
+        host.name          = "robot-host";
+        host.vendor        = "Robot Audio Plugins";
+        host.url           = "";
+        host.versionString = "1.0";
+        host.getExtension    = [](const clap::Host*, const char*) -> const void* { return nullptr; };
+        host.requestRestart  = [](const clap::Host*) {};
+        host.requestProcess  = [](const clap::Host*) {};
+        host.requestCallback = [](const clap::Host*) {};
+
+        inEvents.ctx  = this;
+        inEvents.size = [](const clap::InputEvents* list) -> uint32_t {
+            return ((ClapInstance*)list->ctx)->pending ? 1 : 0;
+        };
+        inEvents.get  = [](const clap::InputEvents* list, uint32_t) -> const clap::EventHeader* {
+            return &((ClapInstance*)list->ctx)->event.header;
+        };
+        outEvents.ctx     = this;
+        outEvents.tryPush = [](const clap::OutputEvents*, const clap::EventHeader*) { return true; };
+    }
+
+    ~ClapInstance()
+    {
+        if (plugin != nullptr)
+        {
+            deactivate();
+            plugin->destroy(plugin);
+        }
+        if (initialized)
+            entry->deinit();
+    }
+
+    bool init(const std::string& path, std::string& error)
+    {
+        if (!(initialized = entry->init(path.c_str())))
+        {
+            error = "clap_entry init failed";
+            return false;
+        }
+        const clap::PluginFactory* const factory
+            = (const clap::PluginFactory*)entry->getFactory("clap.plugin-factory");
+        const clap::PluginDescriptor* const desc
+            = factory != nullptr && factory->getPluginCount(factory) > 0
+            ? factory->getPluginDescriptor(factory, 0) : nullptr;
+        if (desc == nullptr || (plugin = factory->createPlugin(factory, &host, desc->id)) == nullptr)
+        {
+            error = "no plugin in the factory";
+            return false;
+        }
+        if (!plugin->init(plugin))
+        {
+            error = "plugin init failed";
+            return false;
+        }
+
+        if (const clap::PluginParams* const ext = (const clap::PluginParams*)plugin->getExtension(plugin, "clap.params"))
+        {
+            for (uint32_t i=0, count=ext->count(plugin); i < count; ++i)
+            {
+                clap::ParamInfo info;
+                if (!ext->getInfo(plugin, i, &info))
+                    continue;
+                params.push_back({ info.name, (float)info.minValue, (float)info.maxValue });
+                paramIds.push_back(info.id);
+            }
+        }
+
+        // Every channel of every port gets a buffer of its own
+        const clap::PluginAudioPorts* const ports
+            = (const clap::PluginAudioPorts*)plugin->getExtension(plugin, "clap.audio-ports");
+        std::vector<uint32_t> channels[2];
+        uint32_t total[2] = { 0, 0 };
+        for (int side=0; ports != nullptr && side < 2; ++side)
+        {
+            for (uint32_t i=0, count=ports->count(plugin, side == 0); i < count; ++i)
+            {
+                clap::AudioPortInfo info;
+                channels[side].push_back(ports->get(plugin, i, side == 0, &info) ? info.channelCount : 0);
+                total[side] += channels[side].back();
+            }
+        }
+        setChannels(total[0], total[1]);
+        for (int side=0; side < 2; ++side)
+        {
+            std::vector<std::vector<float>>& buffers = side == 0 ? inputs : outputs;
+            std::vector<float*>& pointers = pointerLists[side];
+            for (std::vector<float>& buffer : buffers)
+                pointers.push_back(buffer.data());
+
+            uint32_t first = 0;
+            for (uint32_t count : channels[side])
+            {
+                clap::AudioBuffer buffer = {};
+                buffer.data32       = pointers.data() + first;
+                buffer.channelCount = count;
+                audio[side].push_back(buffer);
+                first += count;
+            }
+        }
+
+        return true;
+    }
+
+    bool activate(double sampleRate) override
+    {
+        if (!(active = plugin->activate(plugin, sampleRate, 1, kMaxFrames)))
+            return false;
+        processing = plugin->startProcessing(plugin);
+        return true;
+    }
+
+    void deactivate() override
+    {
+        if (processing)
+            plugin->stopProcessing(plugin);
+        if (active)
+            plugin->deactivate(plugin);
+        active = processing = false;
+    }
+
+    void setParam(uint32_t index, float normalized) override
+    {
+        event.header.size    = sizeof(event);
+        event.header.time    = 0;
+        event.header.spaceId = 0;
+        event.header.type    = clap::kEventParamValue;
+        event.header.flags   = 0;
+        event.paramId   = paramIds[index];
+        event.cookie    = nullptr;
+        event.noteId    = -1;
+        event.portIndex = -1;
+        event.channel   = -1;
+        event.key       = -1;
+        event.value     = plain(index, normalized);
+        pending = true;
+    }
+
+    void process(uint32_t frames) override
+    {
+        clap::Process data = {};
+        data.steadyTime        = steadyTime;
+        data.framesCount       = frames;
+        data.audioInputs       = audio[0].data();
+        data.audioOutputs      = audio[1].data();
+        data.audioInputsCount  = (uint32_t)audio[0].size();
+        data.audioOutputsCount = (uint32_t)audio[1].size();
+        data.inEvents          = &inEvents;
+        data.outEvents         = &outEvents;
+        plugin->process(plugin, &data);
+        steadyTime += frames;
+        pending = false;
+    }
+
+    static Instance* load(void* lib, const std::string& path, double, std::string& error)
+    {
+        const clap::PluginEntry* const entry = (const clap::PluginEntry*)dlsym(lib, "clap_entry");
+        if (entry == nullptr)
+        {
+            error = "no clap_entry";
+            return nullptr;
+        }
+
+        ClapInstance* const instance = new ClapInstance(lib, entry);
+        if (!instance->init(path, error))
+        {
+            delete instance;
+            return nullptr;
+        }
+        return instance;
+    }
+
+private:
+    const clap::PluginEntry* entry;
+    const clap::Plugin* plugin = nullptr;
+    bool initialized = false, active = false, processing = false;
+    clap::Host host;
+
+    std::vector<uint32_t> paramIds;
+    clap::EventParamValue event;
+    bool pending = false;
+    clap::InputEvents  inEvents;
+    clap::OutputEvents outEvents;
+
+    std::vector<float*> pointerLists[2];
+    std::vector<clap::AudioBuffer> audio[2];
+    int64_t steadyTime = 0;
+};
+
+// -----------------------------------------------------------------------
+// VST2
+
+class Vst2Instance : public Instance
+{
+public:
+    Vst2Instance(void* lib, vst2::Effect* effect) : Instance(lib), effect(effect) {}
+
+    ~Vst2Instance()
+    {
+        deactivate();
+        effect->dispatcher(effect, vst2::kEffClose, 0, 0, nullptr, 0.0f);
+    }
+
+    void init(double sampleRate)
+    {
+        effect->dispatcher(effect, vst2::kEffOpen, 0, 0, nullptr, 0.0f);
+        effect->dispatcher(effect, vst2::kEffSetSampleRate, 0, 0, nullptr, (float)sampleRate);
+        effect->dispatcher(effect, vst2::kEffSetBlockSize, 0, kMaxFrames, nullptr, 0.0f);
+
+        for (int32_t i=0; i < effect->numParams; ++i)
+        {
+            char name[256] = {};
+            effect->dispatcher(effect, vst2::kEffGetParamName, i, 0, name, 0.0f);
+            params.push_back({ name, 0.0f, 1.0f });
+        }
+
+        setChannels((uint32_t)effect->numInputs, (uint32_t)effect->numOutputs);
+        for (std::vector<float>& buffer : inputs)
+            inPointers.push_back(buffer.data());
+        for (std::vector<float>& buffer : outputs)
+            outPointers.push_back(buffer.data());
+    }
+
+    bool activate(double sampleRate) override
+    {
+        effect->dispatcher(effect, vst2::kEffSetSampleRate, 0, 0, nullptr, (float)sampleRate);
+        effect->dispatcher(effect, vst2::kEffMainsChanged, 0, 1, nullptr, 0.0f);
+        active = true;
+        return true;
+    }
+
+    void deactivate() override
+    {
+        if (active)
+            effect->dispatcher(effect, vst2::kEffMainsChanged, 0, 0, nullptr, 0.0f);
+        active = false;
+    }
+
+    void setParam(uint32_t index, float normalized) override
+    {
+        effect->setParameter(effect, (int32_t)index, normalized);
+    }
+
+    uint32_t getProgramCount() const override
+    {
+        return (uint32_t)effect->numPrograms;
+    }
+
+    void selectProgram(uint32_t index) override
+    {
+        effect->dispatcher(effect, vst2::kEffSetProgram, 0, (intptr_t)index, nullptr, 0.0f);
+    }
+
+    void process(uint32_t frames) override
+    {
+        effect->processReplacing(effect, inPointers.data(), outPointers.data(), (int32_t)frames);
+    }
+
+    static Instance* load(void* lib, const std::string&, double sampleRate, std::string& error)
+    {
+        vst2::MainFunction main = (vst2::MainFunction)dlsym(lib, "VSTPluginMain");
+        if (main == nullptr)
+            main = (vst2::MainFunction)dlsym(lib, "main");
+        vst2::Effect* const effect = main != nullptr ? main(hostCallback) : nullptr;
+        if (effect == nullptr || effect->magic != vst2::kMagic)
+        {
+            error = "no VST2 effect";
+            return nullptr;
+        }
+
+        Vst2Instance* const instance = new Vst2Instance(lib, effect);
+        instance->init(sampleRate);
+        return instance;
+    }
+
+private:
+    static intptr_t hostCallback(vst2::Effect*, int32_t opcode, int32_t, intptr_t, void*, float)
+    {
+        return opcode == vst2::kMasterVersion ? 2400 : 0;
+    }
+
+    vst2::Effect* effect;
+    bool active = false;
+    std::vector<float*> inPointers, outPointers;
+};
+
+// -----------------------------------------------------------------------
+// VST3
+
+/*
+ * Host side objects for the plugin to call back into. They live in the
+ * instance, so reference counting is a no-op. At most one parameter
+ * change per block, output changes are dropped.
+ */
+struct Vst3Queue
+{
+    const vst3::ParamValueQueue* vtbl;
+    uint32_t id;
+    double   value;
+};
+
+struct Vst3Changes
+{
+    const vst3::ParameterChanges* vtbl;
+    Vst3Queue* queue;
+    int32_t    count;
+};
+
+struct Vst3Host
+{
+    const vst3::HostApplication* vtbl;
+};
+
+static bool sameIid(const vst3::Tuid a, const vst3::Tuid b)
+{
+    return std::memcmp(a, b, sizeof(vst3::Tuid)) == 0;
+}
+
+template<const vst3::Tuid& Iid>
+static int32_t vst3QueryInterface(void* self, const vst3::Tuid iid, void** obj)
+{
+    if (sameIid(iid, vst3::kFUnknownIid) || sameIid(iid, Iid))
+    {
+        *obj = self;
+        return vst3::kResultOk;
+    }
+    *obj = nullptr;
+    return vst3::kNoInterface;
+}
+
+static uint32_t vst3Ref(void*)
+{
+    return 1;
+}
+
+static const vst3::ParamValueQueue kVst3QueueVtbl = {
+    vst3QueryInterface<vst3::kParamValueQueueIid>, vst3Ref, vst3Ref,
+    [](void* self) -> uint32_t { return ((Vst3Queue*)self)->id; },
+    [](void*) -> int32_t { return 1; },
+    [](void* self, int32_t, int32_t* offset, double* value) -> int32_t {
+        *offset = 0;
+        *value  = ((Vst3Queue*)self)->value;
+        return vst3::kResultOk;
+    },
+    [](void*, int32_t, double, int32_t* index) -> int32_t {
+        *index = 0;
+        return vst3::kResultOk;
+    }
+};
+
+static const vst3::ParameterChanges kVst3ChangesVtbl = {
+    vst3QueryInterface<vst3::kParameterChangesIid>, vst3Ref, vst3Ref,
+    [](void* self) -> int32_t { return ((Vst3Changes*)self)->count; },
+    [](void* self, int32_t index) -> void* {
+        Vst3Changes* const changes = (Vst3Changes*)self;
+        return index < changes->count ? changes->queue : nullptr;
+    },
+    [](void* self, const uint32_t*, int32_t* index) -> void* {
+        *index = 0;
+        return ((Vst3Changes*)self)->queue;
+    }
+};
+
+static const vst3::HostApplication kVst3HostVtbl = {
+    vst3QueryInterface<vst3::kHostApplicationIid>, vst3Ref, vst3Ref,
+    [](void*, int16_t name[128]) -> int32_t {
+        const char* const text = "robot-host";
+        for (int i=0; i < 128; ++i)
+            if ((name[i] = text[i]) == 0)
+                break;
+        return vst3::kResultOk;
+    },
+    [](void*, const vst3::Tuid, const vst3::Tuid, void** obj) -> int32_t {
+        *obj = nullptr;
+        return vst3::kNoInterface;
+    }
+};
+
+class Vst3Instance : public Instance
+{
+public:
+    Vst3Instance(void* lib, void* factory) : Instance(lib), factory((vst3::PluginFactory**)factory)
+    {
+        host.vtbl       = &kVst3HostVtbl;
+        queue.vtbl      = &kVst3QueueVtbl;
+        discard.vtbl    = &kVst3QueueVtbl;
+        inChanges.vtbl  = &kVst3ChangesVtbl;
+        inChanges.queue = &queue;
+        inChanges.count = 0;
+        outChanges.vtbl  = &kVst3ChangesVtbl;
+        outChanges.queue = &discard;
+        outChanges.count = 0;
+    }
+
+    ~Vst3Instance()
+    {
+        deactivate();
+        if (processor != nullptr)
+            (*processor)->release(processor);
+        if (controller != nullptr)
+        {
+            if ((void*)controller != (void*)component)
+                (*controller)->terminate(controller);
+            (*controller)->release(controller);
+        }
+        if (component != nullptr)
+        {
+            (*component)->terminate(component);
+            (*component)->release(component);
+        }
+        (*factory)->release(factory);
+    }
+
+    bool init(std::string& error)
+    {
+        vst3::ClassInfo info;
+        int32_t index = 0;
+        for (const int32_t count = (*factory)->countClasses(factory); index < count; ++index)
+            if ((*factory)->getClassInfo(factory, index, &info) == vst3::kResultOk
+                && std::strcmp(info.category, "Audio Module Class") == 0)
+                break;
+        if (index == (*factory)->countClasses(factory)
+            || (*factory)->createInstance(factory, info.classId, vst3::kComponentIid,
+                                          (void**)&component) != vst3::kResultOk)
+        {
+            error = "no audio module in the factory";
+            return false;
+        }
+        if ((*component)->initialize(component, &host) != vst3::kResultOk
+            || (*component)->queryInterface(component, vst3::kAudioProcessorIid,
+                                            (void**)&processor) != vst3::kResultOk)
+        {
+            error = "component init failed";
+            return false;
+        }
+
+        // Parameter ids and names are on the controller, a class of its own in DPF
+        vst3::Tuid controllerId;
+        if ((*component)->queryInterface(component, vst3::kEditControllerIid,
+                                         (void**)&controller) != vst3::kResultOk)
+        {
+            controller = nullptr;
+            if ((*component)->getControllerClassId(component, controllerId) == vst3::kResultOk
+                && (*factory)->createInstance(factory, controllerId, vst3::kEditControllerIid,
+                                              (void**)&controller) == vst3::kResultOk)
+                (*controller)->initialize(controller, &host);
+            else
+                controller = nullptr;
+        }
+        for (int32_t i=0, count = controller != nullptr ? (*controller)->getParameterCount(controller) : 0;
+             i < count; ++i)
+        {
+            vst3::ParameterInfo param;
+            if ((*controller)->getParameterInfo(controller, i, &param) != vst3::kResultOk)
+                continue;
+            std::string name;
+            for (int c=0; c < 128 && param.title[c] != 0; ++c)
+                name += (char)param.title[c];
+            params.push_back({ name, 0.0f, 1.0f });
+            paramIds.push_back(param.id);
+        }
+
+        std::vector<int32_t> channels[2];
+        uint32_t total[2] = { 0, 0 };
+        for (int side=0; side < 2; ++side)
+        {
+            const int32_t direction = side == 0 ? vst3::kInput : vst3::kOutput;
+            for (int32_t i=0, count=(*component)->getBusCount(component, vst3::kMediaAudio, direction);
+                 i < count; ++i)
+            {
+                vst3::BusInfo bus;
+                const bool ok = (*component)->getBusInfo(component, vst3::kMediaAudio, direction, i, &bus)
+                             == vst3::kResultOk;
+                channels[side].push_back(ok ? bus.channelCount : 0);
+                total[side] += channels[side].back();
+                (*component)->activateBus(component, vst3::kMediaAudio, direction, i, 1);
+            }
+        }
+        setChannels(total[0], total[1]);
+        for (int side=0; side < 2; ++side)
+        {
+            std::vector<std::vector<float>>& buffers = side == 0 ? inputs : outputs;
+            std::vector<float*>& pointers = pointerLists[side];
+            for (std::vector<float>& buffer : buffers)
+                pointers.push_back(buffer.data());
+
+            uint32_t first = 0;
+            for (int32_t count : channels[side])
+            {
+                vst3::AudioBusBuffers bus = {};
+                bus.channelCount = count;
+                bus.buffers32    = pointers.data() + first;
+                buses[side].push_back(bus);
+                first += count;
+            }
+        }
+
+        return true;
+    }
+
+    bool activate(double sampleRate) override
+    {
+        vst3::ProcessSetup setup = { vst3::kRealtime, vst3::kSample32, (int32_t)kMaxFrames, sampleRate };
+        if ((*processor)->setupProcessing(processor, &setup) != vst3::kResultOk
+            || !(active = (*component)->setActive(component, 1) == vst3::kResultOk))
+            return false;
+        processing = (*processor)->setProcessing(processor, 1) == vst3::kResultOk;
+        return true;
+    }
+
+    void deactivate() override
+    {
+        if (processing)
+            (*processor)->setProcessing(processor, 0);
+        if (active)
+            (*component)->setActive(component, 0);
+        active = processing = false;
+    }
+
+    void setParam(uint32_t index, float normalized) override
+    {
+        queue.id    = paramIds[index];
+        queue.value = normalized;
+        inChanges.count = 1;
+    }
+
+    void process(uint32_t frames) override
+    {
+        vst3::ProcessData data = {};
+        data.processMode    = vst3::kRealtime;
+        data.sampleSize     = vst3::kSample32;
+        data.frames         = (int32_t)frames;
+        data.inputBusCount  = (int32_t)buses[0].size();
+        data.outputBusCount = (int32_t)buses[1].size();
+        data.inputs         = buses[0].data();
+        data.outputs        = buses[1].data();
+        data.inputParams    = &inChanges;
+        data.outputParams   = &outChanges;
+        (*processor)->process(processor, &data);
+        inChanges.count = 0;
+    }
+
+    static Instance* load(void* lib, const std::string&, double, std::string& error)
+    {
+        const vst3::ModuleEntryFunction entry = (vst3::ModuleEntryFunction)dlsym(lib, "ModuleEntry");
+        const vst3::GetFactoryFunction getFactory = (vst3::GetFactoryFunction)dlsym(lib, "GetPluginFactory");
+        if ((entry != nullptr && !entry(lib)) || getFactory == nullptr)
+        {
+            error = "no VST3 factory";
+            return nullptr;
+        }
+        void* const factory = getFactory();
+        if (factory == nullptr)
+        {
+            error = "no VST3 factory";
+            return nullptr;
+        }
+
+        Vst3Instance* const instance = new Vst3Instance(lib, factory);
+        if (!instance->init(error))
+        {
+            delete instance;
+            return nullptr;
+        }
+        return instance;
+    }
+
+private:
+    vst3::PluginFactory**  factory;
+    vst3::Component**      component  = nullptr;
+    vst3::AudioProcessor** processor  = nullptr;
+    vst3::EditController** controller = nullptr;
+    bool active = false, processing = false;
+
+    Vst3Host    host;
+    Vst3Queue   queue, discard;
+    Vst3Changes inChanges, outChanges;
+    std::vector<uint32_t> paramIds;
+
+    std::vector<float*> pointerLists[2];
+    std::vector<vst3::AudioBusBuffers> buses[2];
+};
+
+// -----------------------------------------------------------------------
+// Raw DSP
+
+class HexedDsp : public Instance
+{
+public:
+    explicit HexedDsp(double sampleRate) : Instance(nullptr), left(sampleRate), right(sampleRate)
+    {
+        left.flush(sampleRate);
+        right.flush(sampleRate);
+        params.push_back({ "CutOff", 0.0f, 1.0f });
+        params.push_back({ "Wet", 0.0f, 1.0f });
+        setChannels(2, 2);
+    }
+
+    void setParam(uint32_t index, float normalized) override
+    {
+        if (index != 0)
+            return;
+        left.setCutOff(normalized);
+        right.setCutOff(normalized);
+    }
+
+    void process(uint32_t frames) override
+    {
+        left.process(inputs[0].data(), outputs[0].data(), frames);
+        right.process(inputs[1].data(), outputs[1].data(), frames);
+    }
+
+    ROBOT_DECLARE_ALIGNED_NEW(HexedDsp)
+
+private:
+    RobotHexedFilterDSP left, right;
+};
+
+class MoogDsp : public Instance
+{
+public:
+    explicit MoogDsp(double sampleRate) : Instance(nullptr), dsp(sampleRate)
+    {
+        params.push_back({ "CutOff", 0.0f, 1.0f });
+        params.push_back({ "Wet", 0.0f, 1.0f });
+        setChannels(2, 2);
+        setParam(0, 1.0f);
+    }
+
+    void setParam(uint32_t index, float normalized) override
+    {
+        if (index == 0)
+            dsp.moog_ladder_tune(20.0f * std::pow(1000.0f, normalized), tune, acr);
+    }
+
+    void process(uint32_t frames) override
+    {
+        const float res4 = 4.0f * 0.5f * acr;
+        for (uint32_t i=0; i < frames; ++i)
+        {
+            outputs[0][i] = dsp.moog_ladder_process(inputs[0][i], false, tune, res4);
+            outputs[1][i] = dsp.moog_ladder_process(inputs[1][i], true,  tune, res4);
+        }
+    }
+
+private:
+    RobotMoogFilterDSP dsp;
+    float tune, acr;
+};
+
+// -----------------------------------------------------------------------
+// Runs
+
+struct Format
+{
+    const char*  name;
+    // Binary of the plugin inside bin/
+    std::string (*path)(const std::string& bin, const std::string& plugin);
+    LoadFunction load;
+};
+
+static std::string vst3Path(const std::string& bin, const std::string& plugin)
+{
+    utsname system;
+    const std::string arch = uname(&system) == 0 ? system.machine : "x86_64";
+    return bin + "/" + plugin + ".vst3/Contents/" + arch + "-linux/" + plugin + ".so";
+}
+
+static const Format kFormats[] = {
+    { "ladspa", [](const std::string& bin, const std::string& plugin) {
+          return bin + "/" + plugin + "-ladspa.so"; }, LadspaInstance::load },
+    { "lv2",    [](const std::string& bin, const std::string& plugin) {
+          return bin + "/" + plugin + ".lv2/" + plugin + "_dsp.so"; }, Lv2Instance::load },
+    { "clap",   [](const std::string& bin, const std::string& plugin) {
+          return bin + "/" + plugin + ".clap"; }, ClapInstance::load },
+    { "vst2",   [](const std::string& bin, const std::string& plugin) {
+          return bin + "/" + plugin + "-vst.so"; }, Vst2Instance::load },
+    { "vst3",   vst3Path, Vst3Instance::load },
+};
+
+static const char* const kPlugins[] = {
+    "RobotHexedFilter",
+    "RobotHexedPolyFilter",
+    "RobotMoogFilter"
+};
+
+struct Result
+{
+    std::string plugin;
+    std::string format;
+    double      ns;    // per block
+    double      dspNs; // the dsp row of the plugin, 0 if there is none
+};
+
+// Best of a few fresh instances, in microseconds
+struct Lifecycle
+{
+    std::string plugin;
+    std::string format;
+    double      instantiate;
+    double      activate;
+    double      deactivate;
+    double      reactivate; // at the same rate
+};
+
+static void fillNoise(Instance& instance)
+{
+    uint32_t seed = 1;
+    for (std::vector<float>& input : instance.inputs)
+        for (float& x : input)
+        {
+            seed = seed*1664525u + 1013904223u;
+            x = (float)(int32_t)seed * (1.0f/2147483648.0f);
+        }
+}
+
+/*
+ * Best of five runs of blocks calls, ns per block. CutOff sweeps a triangle
+ * over 64 blocks so every block has a parameter change to apply.
+ */
+static double measure(Instance& instance, uint32_t frames, uint32_t blocks)
+{
+    const int cutoff = instance.findParam("CutOff");
+    const int wet    = instance.findParam("Wet");
+    if (wet >= 0)
+        instance.setParam((uint32_t)wet, 1.0f);
+    fillNoise(instance);
+
+    const auto block = [&](uint32_t i) {
+        if (cutoff >= 0)
+            instance.setParam((uint32_t)cutoff, std::fabs((float)(i % 64) - 32.0f) * (1.0f/32.0f));
+        instance.process(frames);
+    };
+
+    // Lets smoothers settle and warms caches
+    for (uint32_t i=0; i < 256; ++i)
+        block(i);
+
+    double best = 0.0;
+    for (int run=0; run < 5; ++run)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        for (uint32_t i=0; i < blocks; ++i)
+            block(i);
+        const auto end = std::chrono::steady_clock::now();
+
+        const double ns = std::chrono::duration<double, std::nano>(end - start).count() / blocks;
+        if (run == 0 || ns < best)
+            best = ns;
+    }
+    return best;
+}
+
+/*
+ * Calls rtCheck.hpp caught while driving the plugin like a busy session
+ * would, from the first run() after activate on. Blocks change size so
+ * the micro-blocks get cut everywhere. CLAP and VST3 get parameters as
+ * events in process(), their handling counts as run().
+ */
+static uint64_t checkRt(Instance& instance)
+{
+    static const uint32_t kSizes[] = { 1, 31, 32, 64, 256, 1000, kMaxFrames };
+    static const float kValues[] = { 0.0f, 1.0f, 0.5f, 0.25f, 0.75f, 0.0f, 0.6f };
+
+    fillNoise(instance);
+    rtcheck::clear();
+
+    uint32_t count = 0;
+    const auto blocks = [&](uint32_t n) {
+        for (uint32_t i=0; i < n; ++i, ++count)
+        {
+            rtcheck::Scope scope(rtcheck::kRun);
+            instance.process(kSizes[count % (sizeof(kSizes)/sizeof(kSizes[0]))]);
+        }
+    };
+    const auto set = [&](int index, float normalized) {
+        if (index < 0)
+            return;
+        rtcheck::Scope scope(rtcheck::kParameter);
+        instance.setParam((uint32_t)index, normalized);
+    };
+
+    const int cutoff = instance.findParam("CutOff");
+    const int wet    = instance.findParam("Wet");
+    set(wet, 1.0f);
+    blocks(64);
+
+    // Every parameter, Quality and AdaptiveRate switch paths on the way
+    for (uint32_t p=0; p < instance.params.size(); ++p)
+    {
+        for (float value : kValues)
+        {
+            set((int)p, value);
+            blocks(4);
+        }
+    }
+    set(wet, 1.0f);
+
+    // A change in every block
+    for (uint32_t i=0; i < 256; ++i)
+    {
+        set(cutoff, std::fabs((float)(i % 64) - 32.0f) * (1.0f/32.0f));
+        blocks(1);
+    }
+
+    // Health recovery
+    for (std::vector<float>& input : instance.inputs)
+        input[0] = NAN;
+    blocks(1);
+    fillNoise(instance);
+    blocks(64);
+
+    for (uint32_t k=0; k < instance.getProgramCount(); ++k)
+    {
+        {
+            rtcheck::Scope scope(rtcheck::kProgram);
+            instance.selectProgram(k);
+        }
+        set(wet, 1.0f);
+        blocks(32);
+    }
+
+    // Sleep and wake
+    set(wet, 0.0f);
+    blocks(64);
+    set(wet, 1.0f);
+    blocks(64);
+
+    return rtcheck::total();
+}
+
+/*
+ * Times one instance through what a host does before the first run(),
+ * taking the best of five. The library is already open, instantiate is
+ * only the format's load. Tearing down is not timed.
+ */
+static bool measureLifecycle(const Format& format, const std::string& path,
+                             double sampleRate, Lifecycle& out, std::string& error)
+{
+    typedef std::chrono::steady_clock Clock;
+    const auto us = [](Clock::time_point from, Clock::time_point to) {
+        return std::chrono::duration<double, std::micro>(to - from).count();
+    };
+    const auto best = [](int run, double& slot, double value) {
+        if (run == 0 || value < slot)
+            slot = value;
+    };
+
+    for (int run=0; run < 5; ++run)
+    {
+        // Every instance closes the reference it was given
+        void* const library = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+        const Clock::time_point t0 = Clock::now();
+        std::unique_ptr<Instance> instance(format.load(library, path, sampleRate, error));
+        const Clock::time_point t1 = Clock::now();
+        if (!instance)
+        {
+            dlclose(library);
+            return false;
+        }
+        if (!instance->activate(sampleRate))
+        {
+            error = "activate failed";
+            return false;
+        }
+        const Clock::time_point t2 = Clock::now();
+        instance->deactivate();
+        const Clock::time_point t3 = Clock::now();
+        if (!instance->activate(sampleRate))
+        {
+            error = "activate failed";
+            return false;
+        }
+        const Clock::time_point t4 = Clock::now();
+
+        best(run, out.instantiate, us(t0, t1));
+        best(run, out.activate,    us(t1, t2));
+        best(run, out.deactivate,  us(t2, t3));
+        best(run, out.reactivate,  us(t3, t4));
+    }
+    return true;
+}
+
+static void printLifecycleTable(const std::vector<Lifecycle>& results)
+{
+    std::printf("%-22s %-7s %12s %10s %11s %11s\n", "plugin", "format",
+                "instantiate", "activate", "deactivate", "reactivate");
+    for (const Lifecycle& r : results)
+        std::printf("%-22s %-7s %10.1fus %8.1fus %9.1fus %9.1fus\n", r.plugin.c_str(), r.format.c_str(),
+                    r.instantiate, r.activate, r.deactivate, r.reactivate);
+}
+
+static void printLifecycleJson(const std::vector<Lifecycle>& results, double sampleRate)
+{
+    std::printf("{\n  \"sample_rate\": %.0f,\n  \"lifecycle\": [\n", sampleRate);
+    for (size_t k=0; k < results.size(); ++k)
+    {
+        const Lifecycle& r = results[k];
+        std::printf("    { \"plugin\": \"%s\", \"format\": \"%s\", \"instantiate_us\": %.2f,"
+                    " \"activate_us\": %.2f, \"deactivate_us\": %.2f, \"reactivate_us\": %.2f }%s\n",
+                    r.plugin.c_str(), r.format.c_str(), r.instantiate, r.activate, r.deactivate,
+                    r.reactivate, k+1 < results.size() ? "," : "");
+    }
+    std::printf("  ]\n}\n");
+}
+
+static void printTable(const std::vector<Result>& results, uint32_t frames)
+{
+    std::printf("%-22s %-7s %11s %10s %11s\n", "plugin", "format", "ns/block", "ns/sample", "over dsp");
+    for (const Result& r : results)
+    {
+        std::printf("%-22s %-7s %11.1f %10.3f", r.plugin.c_str(), r.format.c_str(), r.ns, r.ns / frames);
+        if (r.dspNs > 0.0 && r.format != "dsp")
+            std::printf(" %+11.1f\n", r.ns - r.dspNs);
+        else
+            std::printf(" %11s\n", "-");
+    }
+}
+
+static void printJson(const std::vector<Result>& results, uint32_t frames)
+{
+    std::printf("{\n  \"frames\": %u,\n  \"runs\": [\n", frames);
+    for (size_t k=0; k < results.size(); ++k)
+    {
+        const Result& r = results[k];
+        std::printf("    { \"plugin\": \"%s\", \"format\": \"%s\", \"ns_per_block\": %.2f",
+                    r.plugin.c_str(), r.format.c_str(), r.ns);
+        if (r.dspNs > 0.0 && r.format != "dsp")
+            std::printf(", \"overhead_ns\": %.2f", r.ns - r.dspNs);
+        std::printf(" }%s\n", k+1 < results.size() ? "," : "");
+    }
+    std::printf("  ]\n}\n");
+}
+
+int main(int argc, char* argv[])
+{
+    bool json = false;
+    bool rtCheck = false;
+    bool lifecycle = false;
+    bool usage = false;
+    std::string bin = "bin";
+    uint32_t frames = 256;
+    uint32_t blocks = 2000;
+    std::vector<std::string> only;
+
+    for (int i=1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--json") == 0)
+            json = true;
+        else if (std::strcmp(argv[i], "--bin") == 0 && i+1 < argc)
+            bin = argv[++i];
+        else if (std::strcmp(argv[i], "--frames") == 0 && i+1 < argc)
+            frames = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--blocks") == 0 && i+1 < argc)
+            blocks = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--rt-check") == 0)
+            rtCheck = true;
+        else if (std::strcmp(argv[i], "--lifecycle") == 0)
+            lifecycle = true;
+        else if (argv[i][0] == '-')
+        {
+            usage = true;
+            break;
+        }
+        else
+            only.push_back(argv[i]);
+    }
+    if (usage || (rtCheck && lifecycle))
+    {
+        std::fprintf(stderr, "usage: %s [--bin DIR] [--json] [--frames N] [--blocks N]"
+                     " [--lifecycle | --rt-check] [plugin ...]\n", argv[0]);
+        return 1;
+    }
+    if (frames < 1 || frames > kMaxFrames || blocks < 1)
+    {
+        std::fprintf(stderr, "frames must be 1-%u and blocks at least 1\n", kMaxFrames);
+        return 1;
+    }
+
+    const double sampleRate = 48000.0;
+    std::vector<Result> results;
+    std::vector<Lifecycle> lifecycles;
+
+    if (rtCheck)
+        rtcheck::init();
+    uint32_t checked = 0, failed = 0;
+    const auto check = [&](Instance& instance, const char* plugin, const char* format) {
+        const bool ok = checkRt(instance) == 0;
+        if (!ok)
+            rtcheck::report((std::string(plugin) + " " + format).c_str());
+        std::printf("%-22s %-7s %s\n", plugin, format, ok ? "ok" : "FAIL");
+        ++checked;
+        failed += ok ? 0 : 1;
+    };
+
+    for (const char* const plugin : kPlugins)
+    {
+        bool wanted = only.empty();
+        for (const std::string& name : only)
+            wanted |= name == plugin;
+        if (!wanted)
+            continue;
+
+        double dspNs = 0.0;
+        std::unique_ptr<Instance> dsp;
+        if (std::strcmp(plugin, "RobotHexedFilter") == 0)
+            dsp.reset(new HexedDsp(sampleRate));
+        else if (std::strcmp(plugin, "RobotMoogFilter") == 0)
+            dsp.reset(new MoogDsp(sampleRate));
+        if (dsp && rtCheck)
+            check(*dsp, plugin, "dsp");
+        else if (dsp && !lifecycle)
+        {
+            dspNs = measure(*dsp, frames, blocks);
+            results.push_back({ plugin, "dsp", dspNs, dspNs });
+        }
+
+        for (const Format& format : kFormats)
+        {
+            const std::string path = format.path(bin, plugin);
+            if (access(path.c_str(), R_OK) != 0)
+                continue;
+
+            void* const library = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+            if (library == nullptr)
+            {
+                std::fprintf(stderr, "%s: %s\n", path.c_str(), dlerror());
+                continue;
+            }
+
+            std::string error;
+            if (lifecycle)
+            {
+                Lifecycle times = { plugin, format.name, 0.0, 0.0, 0.0, 0.0 };
+                if (measureLifecycle(format, path, sampleRate, times, error))
+                    lifecycles.push_back(times);
+                else
+                    std::fprintf(stderr, "%s: %s\n", path.c_str(), error.c_str());
+                dlclose(library);
+                continue;
+            }
+
+            std::unique_ptr<Instance> instance(format.load(library, path, sampleRate, error));
+            if (!instance)
+            {
+                std::fprintf(stderr, "%s: %s\n", path.c_str(), error.c_str());
+                dlclose(library);
+                continue;
+            }
+            if (!instance->activate(sampleRate))
+            {
+                std::fprintf(stderr, "%s: activate failed\n", path.c_str());
+                continue;
+            }
+            if (rtCheck)
+                check(*instance, plugin, format.name);
+            else
+                results.push_back({ plugin, format.name, measure(*instance, frames, blocks), dspNs });
+        }
+    }
+
+    if (rtCheck)
+    {
+        if (checked == 0)
+            std::fprintf(stderr, "nothing to check\n");
+        return checked == 0 || failed > 0 ? 1 : 0;
+    }
+
+    if (lifecycle)
+    {
+        if (lifecycles.empty())
+        {
+            std::fprintf(stderr, "nothing to run, build the plugins first or point --bin at them\n");
+            return 1;
+        }
+        if (json)
+            printLifecycleJson(lifecycles, sampleRate);
+        else
+            printLifecycleTable(lifecycles);
+        return 0;
+    }
+
+    if (results.empty())
+    {
+        std::fprintf(stderr, "nothing to run, build the plugins first or point --bin at them\n");
+        return 1;
+    }
+
+    if (json)
+        printJson(results, frames);
+    else
+        printTable(results, frames);
+    return 0;
+}
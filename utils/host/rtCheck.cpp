@@ -0,0 +1,530 @@
+/*
+ *  Robot Audio Plugins
+ *  Copyright (C) 2023  Martin Bångens
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "rtCheck.hpp"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <sys/mman.h>
+#include <sys/select.h>
+#include <time.h>
+#include <unistd.h>
+
+// glibc's allocator under its public names, forwarding to these needs no
+// dlsym() and so can not recurse
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void  __libc_free(void* ptr);
+void* __libc_memalign(size_t alignment, size_t size);
+void* __libc_valloc(size_t size);
+}
+
+namespace rtcheck {
+
+enum Function
+{
+    kMalloc = 0, kCalloc, kRealloc, kFree, kPosixMemalign, kAlignedAlloc, kMemalign, kValloc,
+    kNew, kDelete,
+    kMutexLock, kMutexTimedLock, kRwLockRead, kRwLockWrite,
+    kCondWait, kCondTimedWait, kCondSignal, kCondBroadcast,
+    kSemWait, kSemTimedWait, kThreadCreate, kThreadJoin,
+    kRead, kWrite, kOpen, kOpenAt, kClose, kFsync,
+    kNanosleep, kClockNanosleep, kUsleep, kSleep, kSchedYield,
+    kPoll, kSelect, kMmap, kMunmap, kSyscall,
+    kFunctionCount
+};
+
+static const char* const kFunctionNames[kFunctionCount] = {
+    "malloc", "calloc", "realloc", "free", "posix_memalign", "aligned_alloc", "memalign", "valloc",
+    "operator new", "operator delete",
+    "pthread_mutex_lock", "pthread_mutex_timedlock", "pthread_rwlock_rdlock", "pthread_rwlock_wrlock",
+    "pthread_cond_wait", "pthread_cond_timedwait", "pthread_cond_signal", "pthread_cond_broadcast",
+    "sem_wait", "sem_timedwait", "pthread_create", "pthread_join",
+    "read", "write", "open", "openat", "close", "fsync",
+    "nanosleep", "clock_nanosleep", "usleep", "sleep", "sched_yield",
+    "poll", "select", "mmap", "munmap", "syscall"
+};
+
+static const char* const kPhaseNames[kPhaseCount] = {
+    "run()", "setParameterValue()", "program change"
+};
+
+static std::atomic<uint64_t> counts[kFunctionCount][kPhaseCount];
+
+// Phase of the innermost Scope on this thread, -1 outside of one
+static __thread int current = -1;
+
+static inline void hit(Function function)
+{
+    if (current >= 0)
+        counts[function][current].fetch_add(1, std::memory_order_relaxed);
+}
+
+// -----------------------------------------------------------------------
+// Forwarding
+
+/*
+ * The libc function behind name. dlsym() may allocate, which only reaches
+ * the allocator above, so resolving lazily is safe. init() resolves them
+ * all up front so no Scope sees the allocation.
+ */
+template<class T>
+static inline T next(T& slot, const char* name)
+{
+    if (slot == nullptr)
+        slot = (T)dlsym(RTLD_NEXT, name);
+    return slot;
+}
+
+#define RT_NEXT(name) next(real_##name, #name)
+
+static int (*real_pthread_mutex_lock)(pthread_mutex_t*);
+static int (*real_pthread_mutex_timedlock)(pthread_mutex_t*, const struct timespec*);
+static int (*real_pthread_rwlock_rdlock)(pthread_rwlock_t*);
+static int (*real_pthread_rwlock_wrlock)(pthread_rwlock_t*);
+static int (*real_pthread_cond_wait)(pthread_cond_t*, pthread_mutex_t*);
+static int (*real_pthread_cond_timedwait)(pthread_cond_t*, pthread_mutex_t*, const struct timespec*);
+static int (*real_pthread_cond_signal)(pthread_cond_t*);
+static int (*real_pthread_cond_broadcast)(pthread_cond_t*);
+static int (*real_sem_wait)(sem_t*);
+static int (*real_sem_timedwait)(sem_t*, const struct timespec*);
+static int (*real_pthread_create)(pthread_t*, const pthread_attr_t*, void* (*)(void*), void*);
+static int (*real_pthread_join)(pthread_t, void**);
+static ssize_t (*real_read)(int, void*, size_t);
+static ssize_t (*real_write)(int, const void*, size_t);
+static int (*real_open)(const char*, int, ...);
+static int (*real_openat)(int, const char*, int, ...);
+static int (*real_close)(int);
+static int (*real_fsync)(int);
+static int (*real_nanosleep)(const struct timespec*, struct timespec*);
+static int (*real_clock_nanosleep)(clockid_t, int, const struct timespec*, struct timespec*);
+static int (*real_usleep)(useconds_t);
+static unsigned (*real_sleep)(unsigned);
+static int (*real_sched_yield)();
+static int (*real_poll)(struct pollfd*, nfds_t, int);
+static int (*real_select)(int, fd_set*, fd_set*, fd_set*, struct timeval*);
+static void* (*real_mmap)(void*, size_t, int, int, int, off_t);
+static int (*real_munmap)(void*, size_t);
+static long (*real_syscall)(long, ...);
+
+void init()
+{
+    RT_NEXT(pthread_mutex_lock);
+    RT_NEXT(pthread_mutex_timedlock);
+    RT_NEXT(pthread_rwlock_rdlock);
+    RT_NEXT(pthread_rwlock_wrlock);
+    RT_NEXT(pthread_cond_wait);
+    RT_NEXT(pthread_cond_timedwait);
+    RT_NEXT(pthread_cond_signal);
+    RT_NEXT(pthread_cond_broadcast);
+    RT_NEXT(sem_wait);
+    RT_NEXT(sem_timedwait);
+    RT_NEXT(pthread_create);
+    RT_NEXT(pthread_join);
+    RT_NEXT(read);
+    RT_NEXT(write);
+    RT_NEXT(open);
+    RT_NEXT(openat);
+    RT_NEXT(close);
+    RT_NEXT(fsync);
+    RT_NEXT(nanosleep);
+    RT_NEXT(clock_nanosleep);
+    RT_NEXT(usleep);
+    RT_NEXT(sleep);
+    RT_NEXT(sched_yield);
+    RT_NEXT(poll);
+    RT_NEXT(select);
+    RT_NEXT(mmap);
+    RT_NEXT(munmap);
+    RT_NEXT(syscall);
+}
+
+// -----------------------------------------------------------------------
+// Counts
+
+Scope::Scope(Phase phase) : outer(current)
+{
+    current = phase;
+}
+
+Scope::~Scope()
+{
+    current = outer;
+}
+
+void clear()
+{
+    for (int f=0; f < kFunctionCount; ++f)
+        for (int p=0; p < kPhaseCount; ++p)
+            counts[f][p].store(0);
+}
+
+uint64_t total()
+{
+    uint64_t sum = 0;
+    for (int f=0; f < kFunctionCount; ++f)
+        for (int p=0; p < kPhaseCount; ++p)
+            sum += counts[f][p].load();
+    return sum;
+}
+
+void report(const char* what)
+{
+    for (int f=0; f < kFunctionCount; ++f)
+        for (int p=0; p < kPhaseCount; ++p)
+            if (const uint64_t count = counts[f][p].load())
+                std::fprintf(stderr, "%s: %s in %s, %llu calls\n", what, kFunctionNames[f],
+                             kPhaseNames[p], (unsigned long long)count);
+}
+
+} // namespace rtcheck
+
+using namespace rtcheck;
+
+// -----------------------------------------------------------------------
+// Allocation
+
+extern "C" {
+
+void* malloc(size_t size)
+{
+    hit(kMalloc);
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size)
+{
+    hit(kCalloc);
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* ptr, size_t size)
+{
+    hit(kRealloc);
+    return __libc_realloc(ptr, size);
+}
+
+// Freeing nothing is harmless and common, it is not counted
+void free(void* ptr)
+{
+    if (ptr == nullptr)
+        return;
+    hit(kFree);
+    __libc_free(ptr);
+}
+
+int posix_memalign(void** ptr, size_t alignment, size_t size)
+{
+    hit(kPosixMemalign);
+    if (alignment < sizeof(void*) || (alignment & (alignment - 1)) != 0)
+        return EINVAL;
+    void* const memory = __libc_memalign(alignment, size);
+    if (memory == nullptr)
+        return ENOMEM;
+    *ptr = memory;
+    return 0;
+}
+
+void* aligned_alloc(size_t alignment, size_t size)
+{
+    hit(kAlignedAlloc);
+    return __libc_memalign(alignment, size);
+}
+
+void* memalign(size_t alignment, size_t size)
+{
+    hit(kMemalign);
+    return __libc_memalign(alignment, size);
+}
+
+void* valloc(size_t size)
+{
+    hit(kValloc);
+    return __libc_valloc(size);
+}
+
+} // extern "C"
+
+void* operator new(std::size_t size)
+{
+    hit(kNew);
+    if (void* const ptr = __libc_malloc(size != 0 ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    hit(kNew);
+    if (void* const ptr = __libc_malloc(size != 0 ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    hit(kNew);
+    return __libc_malloc(size != 0 ? size : 1);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    hit(kNew);
+    return __libc_malloc(size != 0 ? size : 1);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    if (ptr == nullptr)
+        return;
+    hit(kDelete);
+    __libc_free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    if (ptr == nullptr)
+        return;
+    hit(kDelete);
+    __libc_free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    operator delete(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept
+{
+    operator delete[](ptr);
+}
+
+// -----------------------------------------------------------------------
+// Locks and threads
+
+extern "C" {
+
+int pthread_mutex_lock(pthread_mutex_t* mutex)
+{
+    hit(kMutexLock);
+    return RT_NEXT(pthread_mutex_lock)(mutex);
+}
+
+int pthread_mutex_timedlock(pthread_mutex_t* mutex, const struct timespec* timeout)
+{
+    hit(kMutexTimedLock);
+    return RT_NEXT(pthread_mutex_timedlock)(mutex, timeout);
+}
+
+int pthread_rwlock_rdlock(pthread_rwlock_t* lock)
+{
+    hit(kRwLockRead);
+    return RT_NEXT(pthread_rwlock_rdlock)(lock);
+}
+
+int pthread_rwlock_wrlock(pthread_rwlock_t* lock)
+{
+    hit(kRwLockWrite);
+    return RT_NEXT(pthread_rwlock_wrlock)(lock);
+}
+
+int pthread_cond_wait(pthread_cond_t* cond, pthread_mutex_t* mutex)
+{
+    hit(kCondWait);
+    return RT_NEXT(pthread_cond_wait)(cond, mutex);
+}
+
+int pthread_cond_timedwait(pthread_cond_t* cond, pthread_mutex_t* mutex, const struct timespec* timeout)
+{
+    hit(kCondTimedWait);
+    return RT_NEXT(pthread_cond_timedwait)(cond, mutex, timeout);
+}
+
+int pthread_cond_signal(pthread_cond_t* cond)
+{
+    hit(kCondSignal);
+    return RT_NEXT(pthread_cond_signal)(cond);
+}
+
+int pthread_cond_broadcast(pthread_cond_t* cond)
+{
+    hit(kCondBroadcast);
+    return RT_NEXT(pthread_cond_broadcast)(cond);
+}
+
+int sem_wait(sem_t* sem)
+{
+    hit(kSemWait);
+    return RT_NEXT(sem_wait)(sem);
+}
+
+int sem_timedwait(sem_t* sem, const struct timespec* timeout)
+{
+    hit(kSemTimedWait);
+    return RT_NEXT(sem_timedwait)(sem, timeout);
+}
+
+int pthread_create(pthread_t* thread, const pthread_attr_t* attr, void* (*start)(void*), void* arg)
+{
+    hit(kThreadCreate);
+    return RT_NEXT(pthread_create)(thread, attr, start, arg);
+}
+
+int pthread_join(pthread_t thread, void** result)
+{
+    hit(kThreadJoin);
+    return RT_NEXT(pthread_join)(thread, result);
+}
+
+// -----------------------------------------------------------------------
+// System calls
+
+ssize_t read(int fd, void* buffer, size_t size)
+{
+    hit(kRead);
+    return RT_NEXT(read)(fd, buffer, size);
+}
+
+ssize_t write(int fd, const void* buffer, size_t size)
+{
+    hit(kWrite);
+    return RT_NEXT(write)(fd, buffer, size);
+}
+
+int open(const char* path, int flags, ...)
+{
+    hit(kOpen);
+    mode_t mode = 0;
+    if (flags & (O_CREAT | O_TMPFILE))
+    {
+        va_list args;
+        va_start(args, flags);
+        mode = (mode_t)va_arg(args, int);
+        va_end(args);
+    }
+    return RT_NEXT(open)(path, flags, mode);
+}
+
+int openat(int dir, const char* path, int flags, ...)
+{
+    hit(kOpenAt);
+    mode_t mode = 0;
+    if (flags & (O_CREAT | O_TMPFILE))
+    {
+        va_list args;
+        va_start(args, flags);
+        mode = (mode_t)va_arg(args, int);
+        va_end(args);
+    }
+    return RT_NEXT(openat)(dir, path, flags, mode);
+}
+
+int close(int fd)
+{
+    hit(kClose);
+    return RT_NEXT(close)(fd);
+}
+
+int fsync(int fd)
+{
+    hit(kFsync);
+    return RT_NEXT(fsync)(fd);
+}
+
+int nanosleep(const struct timespec* duration, struct timespec* rest)
+{
+    hit(kNanosleep);
+    return RT_NEXT(nanosleep)(duration, rest);
+}
+
+int clock_nanosleep(clockid_t clock, int flags, const struct timespec* duration, struct timespec* rest)
+{
+    hit(kClockNanosleep);
+    return RT_NEXT(clock_nanosleep)(clock, flags, duration, rest);
+}
+
+int usleep(useconds_t duration)
+{
+    hit(kUsleep);
+    return RT_NEXT(usleep)(duration);
+}
+
+unsigned sleep(unsigned seconds)
+{
+    hit(kSleep);
+    return RT_NEXT(sleep)(seconds);
+}
+
+int sched_yield()
+{
+    hit(kSchedYield);
+    return RT_NEXT(sched_yield)();
+}
+
+int poll(struct pollfd* fds, nfds_t count, int timeout)
+{
+    hit(kPoll);
+    return RT_NEXT(poll)(fds, count, timeout);
+}
+
+int select(int count, fd_set* reads, fd_set* writes, fd_set* errors, struct timeval* timeout)
+{
+    hit(kSelect);
+    return RT_NEXT(select)(count, reads, writes, errors, timeout);
+}
+
+void* mmap(void* address, size_t size, int protection, int flags, int fd, off_t offset)
+{
+    hit(kMmap);
+    return RT_NEXT(mmap)(address, size, protection, flags, fd, offset);
+}
+
+int munmap(void* address, size_t size)
+{
+    hit(kMunmap);
+    return RT_NEXT(munmap)(address, size);
+}
+
+// Futex waits and wakes are the usual way here, six arguments is the most
+// any system call takes
+long syscall(long number, ...)
+{
+    hit(kSyscall);
+    va_list args;
+    va_start(args, number);
+    long a[6];
+    for (int i=0; i < 6; ++i)
+        a[i] = va_arg(args, long);
+    va_end(args);
+    return RT_NEXT(syscall)(number, a[0], a[1], a[2], a[3], a[4], a[5]);
+}
+
+} // extern "C"
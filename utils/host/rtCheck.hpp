@@ -0,0 +1,67 @@
+/*
+ *  Robot Audio Plugins
+ *  Copyright (C) 2023  Martin Bångens
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <cstdint>
+/*
+ * Catches what a plugin must not do on the audio thread
+ *
+ * rtCheck.cpp defines malloc and friends, operator new and delete, the
+ * pthread mutex, condition variable and thread calls and the blocking
+ * system calls in the host itself. The dynamic linker binds the plugins
+ * and the C++ runtime to those, and they forward to libc. While a Scope
+ * lives on a thread every call from that thread is counted against the
+ * phase the scope names, outside of one they only forward.
+ *
+ * Calls libc makes to itself do not go through the symbol table and are
+ * not seen, fwrite() is missed where write() is not. That still catches
+ * everything the plugins call themselves.
+ */
+namespace rtcheck {
+
+enum Phase
+{
+    kRun = 0,
+    kParameter,
+    kProgram,
+    kPhaseCount
+};
+
+// Resolves the libc functions, call it before the first Scope
+void init();
+
+class Scope
+{
+public:
+    explicit Scope(Phase phase);
+    ~Scope();
+private:
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+    const int outer;
+};
+
+// Forgets the counts, for the next plugin
+void clear();
+
+// Calls counted since clear()
+uint64_t total();
+
+// One line per function and phase that was called, to stderr
+void report(const char* what);
+
+} // namespace rtcheck
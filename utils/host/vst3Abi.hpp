@@ -0,0 +1,213 @@
+/*
+ *  Robot Audio Plugins
+ *  Copyright (C) 2023  Martin Bångens
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <cstdint>
+/*
+ * The VST3 interfaces robot-host calls, as plain vtables in the order of
+ * the SDK. Objects are pointers to a vtable pointer, every method takes
+ * the object first. Interface ids are in the byte order of Linux and
+ * macOS builds, which is not the COM order Windows uses.
+ */
+
+namespace vst3 {
+
+typedef uint8_t Tuid[16];
+
+enum
+{
+    kResultOk    = 0,
+    kResultFalse = 1,
+    kNoInterface = -1,
+
+    kMediaAudio = 0,
+    kInput  = 0,
+    kOutput = 1,
+
+    kRealtime = 0,
+    kSample32 = 0
+};
+
+#define ROBOT_VST3_ID(a, b, c, d) {                                              \
+    (uint8_t)((a) >> 24), (uint8_t)((a) >> 16), (uint8_t)((a) >> 8), (uint8_t)(a), \
+    (uint8_t)((b) >> 24), (uint8_t)((b) >> 16), (uint8_t)((b) >> 8), (uint8_t)(b), \
+    (uint8_t)((c) >> 24), (uint8_t)((c) >> 16), (uint8_t)((c) >> 8), (uint8_t)(c), \
+    (uint8_t)((d) >> 24), (uint8_t)((d) >> 16), (uint8_t)((d) >> 8), (uint8_t)(d) }
+
+static const Tuid kFUnknownIid         = ROBOT_VST3_ID(0x00000000, 0x00000000, 0xC0000000, 0x00000046);
+static const Tuid kComponentIid        = ROBOT_VST3_ID(0xE831FF31, 0xF2D54301, 0x928EBBEE, 0x25697802);
+static const Tuid kAudioProcessorIid   = ROBOT_VST3_ID(0x42043F99, 0xB7DA453C, 0xA569E79D, 0x9AAEC33D);
+static const Tuid kEditControllerIid   = ROBOT_VST3_ID(0xDCD7BBE3, 0x7742448D, 0xA874AACC, 0x979C759E);
+static const Tuid kHostApplicationIid  = ROBOT_VST3_ID(0x58E595CC, 0xDB2D4969, 0x8B6AAF8C, 0x36A664E5);
+static const Tuid kParameterChangesIid = ROBOT_VST3_ID(0xA4779663, 0x0BB64A56, 0xB44384A8, 0x466FEB9D);
+static const Tuid kParamValueQueueIid  = ROBOT_VST3_ID(0x01263A18, 0xED074F6F, 0x98C9D356, 0x4686F9BA);
+
+#undef ROBOT_VST3_ID
+
+#define ROBOT_VST3_UNKNOWN                                                      \
+    int32_t  (*queryInterface)(void* self, const Tuid iid, void** obj);         \
+    uint32_t (*addRef)(void* self);                                             \
+    uint32_t (*release)(void* self);
+
+#define ROBOT_VST3_PLUGIN_BASE                                                  \
+    int32_t (*initialize)(void* self, void* context);                           \
+    int32_t (*terminate)(void* self);
+
+struct ClassInfo
+{
+    Tuid    classId;
+    int32_t cardinality;
+    char    category[32];
+    char    name[64];
+};
+
+struct PluginFactory
+{
+    ROBOT_VST3_UNKNOWN
+    int32_t (*getFactoryInfo)(void* self, void* info);
+    int32_t (*countClasses)(void* self);
+    int32_t (*getClassInfo)(void* self, int32_t index, ClassInfo* info);
+    int32_t (*createInstance)(void* self, const Tuid classId, const Tuid iid, void** obj);
+};
+
+struct BusInfo
+{
+    int32_t  mediaType;
+    int32_t  direction;
+    int32_t  channelCount;
+    int16_t  name[128];
+    int32_t  busType;
+    uint32_t flags;
+};
+
+struct Component
+{
+    ROBOT_VST3_UNKNOWN
+    ROBOT_VST3_PLUGIN_BASE
+    int32_t (*getControllerClassId)(void* self, Tuid classId);
+    int32_t (*setIoMode)(void* self, int32_t mode);
+    int32_t (*getBusCount)(void* self, int32_t mediaType, int32_t direction);
+    int32_t (*getBusInfo)(void* self, int32_t mediaType, int32_t direction, int32_t index, BusInfo* info);
+    int32_t (*getRoutingInfo)(void* self, void* in, void* out);
+    int32_t (*activateBus)(void* self, int32_t mediaType, int32_t direction, int32_t index, uint8_t state);
+    int32_t (*setActive)(void* self, uint8_t state);
+    int32_t (*setState)(void* self, void* stream);
+    int32_t (*getState)(void* self, void* stream);
+};
+
+struct ProcessSetup
+{
+    int32_t processMode;
+    int32_t sampleSize;
+    int32_t maxBlockSize;
+    double  sampleRate;
+};
+
+struct AudioBusBuffers
+{
+    int32_t  channelCount;
+    uint64_t silenceFlags;
+    float**  buffers32;
+};
+
+struct ProcessData
+{
+    int32_t          processMode;
+    int32_t          sampleSize;
+    int32_t          frames;
+    int32_t          inputBusCount;
+    int32_t          outputBusCount;
+    AudioBusBuffers* inputs;
+    AudioBusBuffers* outputs;
+    void*            inputParams;
+    void*            outputParams;
+    void*            inputEvents;
+    void*            outputEvents;
+    void*            context;
+};
+
+struct AudioProcessor
+{
+    ROBOT_VST3_UNKNOWN
+    int32_t  (*setBusArrangements)(void* self, uint64_t* inputs, int32_t inputCount,
+                                   uint64_t* outputs, int32_t outputCount);
+    int32_t  (*getBusArrangement)(void* self, int32_t direction, int32_t index, uint64_t* arrangement);
+    int32_t  (*canProcessSampleSize)(void* self, int32_t size);
+    uint32_t (*getLatencySamples)(void* self);
+    int32_t  (*setupProcessing)(void* self, ProcessSetup* setup);
+    int32_t  (*setProcessing)(void* self, uint8_t state);
+    int32_t  (*process)(void* self, ProcessData* data);
+    uint32_t (*getTailSamples)(void* self);
+};
+
+struct ParameterInfo
+{
+    uint32_t id;
+    int16_t  title[128];
+    int16_t  shortTitle[128];
+    int16_t  units[128];
+    int32_t  stepCount;
+    double   defaultValue;
+    int32_t  unitId;
+    int32_t  flags;
+};
+
+struct EditController
+{
+    ROBOT_VST3_UNKNOWN
+    ROBOT_VST3_PLUGIN_BASE
+    int32_t (*setComponentState)(void* self, void* stream);
+    int32_t (*setState)(void* self, void* stream);
+    int32_t (*getState)(void* self, void* stream);
+    int32_t (*getParameterCount)(void* self);
+    int32_t (*getParameterInfo)(void* self, int32_t index, ParameterInfo* info);
+};
+
+// Implemented by the host
+
+struct HostApplication
+{
+    ROBOT_VST3_UNKNOWN
+    int32_t (*getName)(void* self, int16_t name[128]);
+    int32_t (*createInstance)(void* self, const Tuid classId, const Tuid iid, void** obj);
+};
+
+struct ParamValueQueue
+{
+    ROBOT_VST3_UNKNOWN
+    uint32_t (*getParameterId)(void* self);
+    int32_t  (*getPointCount)(void* self);
+    int32_t  (*getPoint)(void* self, int32_t index, int32_t* offset, double* value);
+    int32_t  (*addPoint)(void* self, int32_t offset, double value, int32_t* index);
+};
+
+struct ParameterChanges
+{
+    ROBOT_VST3_UNKNOWN
+    int32_t (*getParameterCount)(void* self);
+    void*   (*getParameterData)(void* self, int32_t index);
+    void*   (*addParameterData)(void* self, const uint32_t* id, int32_t* index);
+};
+
+#undef ROBOT_VST3_UNKNOWN
+#undef ROBOT_VST3_PLUGIN_BASE
+
+typedef void* (*GetFactoryFunction)();
+typedef bool  (*ModuleEntryFunction)(void* handle);
+typedef bool  (*ModuleExitFunction)();
+
+} // namespace vst3
@@ -0,0 +1,460 @@
+/*
+ *  Robot Audio Plugins
+ *  Copyright (C) 2023  Martin Bångens
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Offline render of a wav file through RobotHexedFilterDSP on every core
+ *
+ * The file is cut into chunks and every chunk of every channel is a task.
+ * A chunk gets a filter of its own that first runs over the pre-roll, the
+ * input just before the chunk, and that output is thrown away. Once the
+ * state from before the pre-roll has died out, the filter is where the
+ * sequential render would be, so the chunks join without a seam. The first
+ * chunk starts at the beginning of the file and needs no pre-roll.
+ *
+ * The pre-roll is measured from the settings: how long the impulse
+ * response of the filter takes to fall below float resolution. A filter
+ * that rings longer than kMaxPreRoll (close to self oscillation) keeps
+ * its history, the chunks then can not match and it renders on one core.
+ * --verify renders sequentially as well and fails when the two differ by
+ * more than the tolerance.
+ *
+ *     robot-render [--cutoff %] [--resonance %] [--mode 1-4] [--eco]
+ *                  [--threads N] [--preroll S] [--chunk S]
+ *                  [--verify] [--tolerance DB] in.wav out.wav
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "RobotHexedFilterDSP.hpp"
+#include "threadPool.hpp"
+
+// Frames per process() call, what a host would hand over
+static const uint32_t kSlice = 4096;
+// Impulse response level, relative to its peak, that counts as gone
+static const double kSettle = 1e-7;
+// Longer than this and the filter is taken to ring on
+static const double kMaxPreRoll = 10.0;
+// Fewer chunks per thread balance badly, more waste pre-roll
+static const uint32_t kChunksPerThread = 4;
+// Chunks at least this many pre-rolls long
+static const uint32_t kMinChunkPreRolls = 16;
+
+static double now()
+{
+    return std::chrono::duration<double>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// -----------------------------------------------------------------------
+// Wav
+
+struct Audio
+{
+    double   sampleRate = 0.0;
+    uint32_t frames = 0;
+    std::vector<std::vector<float>> channels;
+};
+
+static uint32_t readU32(const uint8_t* p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t readU16(const uint8_t* p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static void writeU32(std::vector<uint8_t>& out, uint32_t value)
+{
+    for (int i=0; i < 4; ++i)
+        out.push_back((uint8_t)(value >> (8*i)));
+}
+
+static void writeU16(std::vector<uint8_t>& out, uint16_t value)
+{
+    out.push_back((uint8_t)value);
+    out.push_back((uint8_t)(value >> 8));
+}
+
+// 16, 24 and 32 bit integer or 32 bit float, plain or extensible
+static bool readWav(const char* path, Audio& audio)
+{
+    FILE* const file = std::fopen(path, "rb");
+    if (file == nullptr)
+    {
+        std::fprintf(stderr, "%s: can not open\n", path);
+        return false;
+    }
+    std::vector<uint8_t> data;
+    uint8_t buffer[1 << 16];
+    for (size_t n; (n = std::fread(buffer, 1, sizeof(buffer), file)) > 0;)
+        data.insert(data.end(), buffer, buffer + n);
+    std::fclose(file);
+
+    if (data.size() < 12 || std::memcmp(&data[0], "RIFF", 4) != 0
+        || std::memcmp(&data[8], "WAVE", 4) != 0)
+    {
+        std::fprintf(stderr, "%s: not a wav file\n", path);
+        return false;
+    }
+
+    uint16_t format = 0, channels = 0, bits = 0;
+    const uint8_t* samples = nullptr;
+    size_t bytes = 0;
+    for (size_t pos = 12; pos + 8 <= data.size();)
+    {
+        const uint8_t* const chunk = &data[pos];
+        const size_t size = std::min<size_t>(readU32(chunk + 4), data.size() - pos - 8);
+        if (std::memcmp(chunk, "fmt ", 4) == 0 && size >= 16)
+        {
+            format   = readU16(chunk + 8);
+            channels = readU16(chunk + 10);
+            audio.sampleRate = readU32(chunk + 12);
+            bits     = readU16(chunk + 22);
+            // WAVE_FORMAT_EXTENSIBLE, the format is in the sub format GUID
+            if (format == 0xFFFE && size >= 26)
+                format = readU16(chunk + 32);
+        }
+        else if (std::memcmp(chunk, "data", 4) == 0)
+        {
+            samples = chunk + 8;
+            bytes   = size;
+        }
+        pos += 8 + size + (size & 1);
+    }
+
+    const bool pcm = format == 1 && (bits == 16 || bits == 24 || bits == 32);
+    const bool ieee = format == 3 && bits == 32;
+    if (samples == nullptr || channels == 0 || audio.sampleRate <= 0.0 || !(pcm || ieee))
+    {
+        std::fprintf(stderr, "%s: only 16, 24 or 32 bit pcm and 32 bit float wav\n", path);
+        return false;
+    }
+
+    const uint32_t width = bits/8;
+    audio.frames = (uint32_t)(bytes/(width*channels));
+    audio.channels.assign(channels, std::vector<float>(audio.frames));
+    for (uint32_t i=0; i < audio.frames; ++i)
+    {
+        for (uint32_t c=0; c < channels; ++c)
+        {
+            const uint8_t* const p = samples + (size_t(i)*channels + c)*width;
+            float value;
+            if (ieee)
+            {
+                const uint32_t raw = readU32(p);
+                std::memcpy(&value, &raw, sizeof(value));
+            }
+            else if (bits == 16)
+                value = (int16_t)readU16(p) * (1.0f/32768.0f);
+            else if (bits == 24)
+                value = (int32_t)((uint32_t)p[0] << 8 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 24)
+                        * (1.0f/2147483648.0f);
+            else
+                value = (int32_t)readU32(p) * (1.0f/2147483648.0f);
+            audio.channels[c][i] = value;
+        }
+    }
+    return true;
+}
+
+// Always 32 bit float, the render is not dithered
+static bool writeWav(const char* path, const Audio& audio)
+{
+    const uint16_t channels = (uint16_t)audio.channels.size();
+    const uint32_t bytes = audio.frames*channels*4;
+
+    std::vector<uint8_t> out;
+    out.reserve(44 + (size_t)bytes);
+    out.insert(out.end(), { 'R', 'I', 'F', 'F' });
+    writeU32(out, 36 + bytes);
+    out.insert(out.end(), { 'W', 'A', 'V', 'E', 'f', 'm', 't', ' ' });
+    writeU32(out, 16);
+    writeU16(out, 3);
+    writeU16(out, channels);
+    writeU32(out, (uint32_t)audio.sampleRate);
+    writeU32(out, (uint32_t)audio.sampleRate*channels*4);
+    writeU16(out, channels*4);
+    writeU16(out, 32);
+    out.insert(out.end(), { 'd', 'a', 't', 'a' });
+    writeU32(out, bytes);
+    for (uint32_t i=0; i < audio.frames; ++i)
+    {
+        for (uint16_t c=0; c < channels; ++c)
+        {
+            uint32_t raw;
+            std::memcpy(&raw, &audio.channels[c][i], sizeof(raw));
+            writeU32(out, raw);
+        }
+    }
+
+    FILE* const file = std::fopen(path, "wb");
+    if (file == nullptr || std::fwrite(out.data(), 1, out.size(), file) != out.size())
+    {
+        std::fprintf(stderr, "%s: can not write\n", path);
+        if (file != nullptr)
+            std::fclose(file);
+        return false;
+    }
+    return std::fclose(file) == 0;
+}
+
+// -----------------------------------------------------------------------
+// Render
+
+struct Settings
+{
+    float cutoff = 1.0f;
+    float resonance = 0.0f;
+    float mode = 4.0f;
+    bool  eco = false;
+};
+
+// Like activate() in the plugin
+static void setup(RobotHexedFilterDSP& filter, double sampleRate, const Settings& settings)
+{
+    filter.flush(sampleRate);
+    filter.setCutOff(settings.cutoff);
+    filter.setResonance(settings.resonance);
+    filter.setMode(settings.mode);
+    filter.setFast(settings.eco);
+}
+
+static void process(RobotHexedFilterDSP& filter, const float* in, float* out, uint32_t frames)
+{
+    for (uint32_t i=0; i < frames; i += kSlice)
+        filter.process(in + i, out + i, std::min(kSlice, frames - i));
+}
+
+/*
+ * Frames until the impulse response stays below kSettle of its peak, 0
+ * if it does not within kMaxPreRoll. The impulse is small so the filter
+ * stays in its linear range, where it rings the longest. The response is
+ * taken against a second filter fed silence, the kernel adds a small
+ * offset against denormals that never decays.
+ */
+static uint32_t measurePreRoll(double sampleRate, const Settings& settings)
+{
+    RobotHexedFilterDSP filter(sampleRate), silent(sampleRate);
+    setup(filter, sampleRate, settings);
+    setup(silent, sampleRate, settings);
+
+    const uint32_t limit = (uint32_t)(kMaxPreRoll*sampleRate);
+    std::vector<float> in(kSlice, 0.0f), out(kSlice), zero(kSlice, 0.0f), rest(kSlice);
+    in[0] = 1e-3f;
+
+    float    peak = 0.0f;
+    uint32_t last = 0;
+    for (uint32_t pos = 0; pos < limit; pos += kSlice)
+    {
+        filter.process(in.data(), out.data(), kSlice);
+        silent.process(zero.data(), rest.data(), kSlice);
+        in[0] = 0.0f;
+        for (uint32_t i=0; i < kSlice; ++i)
+        {
+            const float level = std::fabs(out[i] - rest[i]);
+            peak = std::max(peak, level);
+            if (level > peak*kSettle)
+                last = pos + i + 1;
+        }
+        // A slice of silence after it, it is gone
+        if (pos >= last + kSlice)
+            return last;
+    }
+    return 0;
+}
+
+struct Job
+{
+    const Audio* in;
+    Audio*   out;
+    Settings settings;
+    uint32_t chunk;
+    uint32_t chunks;
+    uint32_t preRoll;
+};
+
+// One chunk of one channel
+static void renderChunk(void* context, uint32_t index)
+{
+    const Job& job = *(const Job*)context;
+    const uint32_t channel = index / job.chunks;
+    const uint32_t chunk   = index % job.chunks;
+
+    const uint32_t start = chunk*job.chunk;
+    const uint32_t end   = std::min(start + job.chunk, job.in->frames);
+    const uint32_t from  = start - std::min(start, job.preRoll);
+    const float* const in = job.in->channels[channel].data();
+    float* const out = job.out->channels[channel].data();
+
+    RobotHexedFilterDSP filter(job.in->sampleRate);
+    setup(filter, job.in->sampleRate, job.settings);
+
+    // Warm up, the output goes nowhere
+    float sink[kSlice];
+    for (uint32_t i=from; i < start; i += kSlice)
+        filter.process(in + i, sink, std::min(kSlice, start - i));
+    process(filter, in + start, out + start, end - start);
+}
+
+static void render(RobotTaskPool* pool, const Audio& in, Audio& out, const Settings& settings,
+                   uint32_t chunk, uint32_t preRoll)
+{
+    out.sampleRate = in.sampleRate;
+    out.frames     = in.frames;
+    out.channels.assign(in.channels.size(), std::vector<float>(in.frames));
+
+    Job job;
+    job.in       = &in;
+    job.out      = &out;
+    job.settings = settings;
+    job.chunk    = std::max<uint32_t>(chunk, 1);
+    job.chunks   = (in.frames + job.chunk - 1)/job.chunk;
+    job.preRoll  = preRoll;
+    robotExec(pool, renderChunk, &job, job.chunks*(uint32_t)in.channels.size());
+}
+
+// -----------------------------------------------------------------------
+
+static double toDb(double value)
+{
+    return 20.0*std::log10(std::max(value, 1e-30));
+}
+
+int main(int argc, char* argv[])
+{
+    Settings settings;
+    uint32_t threads = std::max(1u, std::thread::hardware_concurrency());
+    double preRollSeconds = -1.0;
+    double chunkSeconds = -1.0;
+    bool   verify = false;
+    double tolerance = -100.0;
+    std::vector<const char*> paths;
+
+    for (int i=1; i < argc; ++i)
+    {
+        const bool value = i+1 < argc;
+        if (std::strcmp(argv[i], "--cutoff") == 0 && value)
+            settings.cutoff = (float)std::atof(argv[++i])*0.01f;
+        else if (std::strcmp(argv[i], "--resonance") == 0 && value)
+            settings.resonance = (float)std::atof(argv[++i])*0.01f;
+        else if (std::strcmp(argv[i], "--mode") == 0 && value)
+            settings.mode = (float)std::atof(argv[++i]);
+        else if (std::strcmp(argv[i], "--eco") == 0)
+            settings.eco = true;
+        else if (std::strcmp(argv[i], "--threads") == 0 && value)
+            threads = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--preroll") == 0 && value)
+            preRollSeconds = std::atof(argv[++i]);
+        else if (std::strcmp(argv[i], "--chunk") == 0 && value)
+            chunkSeconds = std::atof(argv[++i]);
+        else if (std::strcmp(argv[i], "--verify") == 0)
+            verify = true;
+        else if (std::strcmp(argv[i], "--tolerance") == 0 && value)
+            tolerance = std::atof(argv[++i]);
+        else if (argv[i][0] == '-')
+        {
+            paths.clear();
+            break;
+        }
+        else
+            paths.push_back(argv[i]);
+    }
+    if (paths.size() != 2)
+    {
+        std::fprintf(stderr,
+                     "usage: %s [--cutoff %%] [--resonance %%] [--mode 1-4] [--eco]\n"
+                     "       [--threads N] [--preroll S] [--chunk S] [--verify] [--tolerance DB]\n"
+                     "       in.wav out.wav\n", argv[0]);
+        return 2;
+    }
+
+    Audio in;
+    if (!readWav(paths[0], in))
+        return 1;
+
+    uint32_t preRoll;
+    if (preRollSeconds >= 0.0)
+        preRoll = (uint32_t)(preRollSeconds*in.sampleRate);
+    else
+    {
+        preRoll = measurePreRoll(in.sampleRate, settings);
+        if (preRoll == 0)
+        {
+            std::fprintf(stderr, "filter rings for more than %g s, rendering on one core\n",
+                         kMaxPreRoll);
+            threads = 1;
+        }
+    }
+
+    uint32_t chunk;
+    if (threads == 1)
+        chunk = in.frames;
+    else if (chunkSeconds > 0.0)
+        chunk = (uint32_t)(chunkSeconds*in.sampleRate);
+    else
+    {
+        const uint32_t tasks = threads*kChunksPerThread;
+        const uint32_t perChannel = std::max<uint32_t>(1, tasks/(uint32_t)in.channels.size());
+        chunk = std::max((in.frames + perChannel - 1)/perChannel, preRoll*kMinChunkPreRolls);
+    }
+
+    RobotThreadPool pool(threads);
+    Audio out;
+    const double t0 = now();
+    render(&pool, in, out, settings, chunk, preRoll);
+    const double t1 = now();
+    std::printf("%u frames, %u threads, chunk %u, pre-roll %u (%.1f ms): %.3f s\n",
+                in.frames, threads, std::min(chunk, in.frames), preRoll,
+                1000.0*preRoll/in.sampleRate, t1 - t0);
+
+    if (!writeWav(paths[1], out))
+        return 1;
+    if (!verify)
+        return 0;
+
+    Audio reference;
+    const double t2 = now();
+    render(nullptr, in, reference, settings, in.frames, 0);
+    const double t3 = now();
+
+    double peak = 0.0, error = 0.0;
+    for (size_t c=0; c < out.channels.size(); ++c)
+    {
+        for (uint32_t i=0; i < out.frames; ++i)
+        {
+            peak  = std::max(peak, (double)std::fabs(reference.channels[c][i]));
+            error = std::max(error, (double)std::fabs(out.channels[c][i] - reference.channels[c][i]));
+        }
+    }
+    const bool pass = toDb(error) <= tolerance;
+    std::printf("sequential: %.3f s, %.2fx\n", t3 - t2, (t3 - t2)/(t1 - t0));
+    std::printf("max difference %.1f dBFS (peak %.1f dBFS), tolerance %.1f dBFS: %s\n",
+                toDb(error), toDb(peak), tolerance, pass ? "pass" : "FAIL");
+    return pass ? 0 : 1;
+}